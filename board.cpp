@@ -90,8 +90,51 @@ Board::Board(int size)
 
 
 
+namespace {
+
+/**
+ * @brief Random-looking 64-bit key of a (plane, row, column, state) feature (splitmix64 finalizer)
+ */
+std::uint64_t zobrist_key(int plane, int row, int col, int state) {
+  std::uint64_t z = ((static_cast<std::uint64_t>(plane) * 16 + row) * 16 + col) * 4 + state + 1;
+  z *= 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+}  // namespace
+
 int Board::get_board_size() const { return board_size; }
 
+std::uint64_t Board::hash(Cell_state player) const {
+  // Plane 0: cells, 1-4: history, 5: capture path, 6: restricted move, 7: player to move
+  std::uint64_t h = zobrist_key(7, 0, 0, static_cast<int>(player));
+  for (size_t row = 0; row < board.size(); ++row) {
+    for (size_t col = 0; col < board[row].size(); ++col) {
+      if (board[row][col] != Cell_state::Empty) {
+        h ^= zobrist_key(0, row, col, static_cast<int>(board[row][col]));
+      }
+    }
+  }
+  for (size_t plane = 0; plane < history.size(); ++plane) {
+    for (size_t row = 0; row < history[plane].size(); ++row) {
+      for (size_t col = 0; col < history[plane][row].size(); ++col) {
+        if (history[plane][row][col] != Cell_state::Empty) {
+          h ^= zobrist_key(1 + plane, row, col, static_cast<int>(history[plane][row][col]));
+        }
+      }
+    }
+  }
+  for (const auto& cell : path) {
+    h ^= zobrist_key(5, cell[0], cell[1], 0);
+  }
+  if (restricted_move[0] >= 0) {
+    h ^= zobrist_key(6, restricted_move[0], restricted_move[1], 0);
+  }
+  return h;
+}
+
 bool Board::is_within_bounds(int move_x, int move_y) const {
   return move_x >= 0  && move_x < 5 && move_y >= 0 && move_y < board_size;
 }
@@ -309,38 +352,43 @@ void Board::take(int move_x, int move_y, int dir, int tar, Cell_state player) {
 }
 torch::Tensor Board::to_tensor(Cell_state player) const {
 
-    torch::Tensor stacked = torch::zeros({11, 5, 9}, torch::kFloat32);
+    torch::Tensor stacked = torch::empty({11, 5, 9}, torch::kFloat32);
+    write_planes(player, stacked.data_ptr<float>());
+    return stacked; 
+}
+
+void Board::write_planes(Cell_state player, float* planes) const {
+    const int ROWS = 5;
+    const int COLS = 9;
+    std::fill(planes, planes + input_size, 0.0f);
 
     // Helper lambda to fill a plane for a board
-    auto fill_planes = [](torch::Tensor& tensor, int start_plane, 
-                        const std::vector<std::vector<Cell_state>>& b,
-                        Cell_state current_player) 
-    {
-        for (int x = 0; x < 5; ++x) {
-            for (int y = 0; y < 9; ++y) {
-                if (b[x][y] == current_player) {
-                    tensor[start_plane][x][y] = 1.0f;
+    auto fill_planes = [&](int start_plane, const std::vector<std::vector<Cell_state>>& b) {
+        float* own = planes + start_plane * ROWS * COLS;
+        float* opponent = own + ROWS * COLS;
+        for (int x = 0; x < ROWS; ++x) {
+            for (int y = 0; y < COLS; ++y) {
+                if (b[x][y] == player) {
+                    own[x * COLS + y] = 1.0f;
                 } else if (b[x][y] != Cell_state::Empty) {
-                    tensor[start_plane + 1][x][y] = 1.0f;
+                    opponent[x * COLS + y] = 1.0f;
                 }
-                //Current plane
-                float fill_value = (current_player == Cell_state::X) ? 0.0f : 1.0f; //0 if player 1, 1 if player 2
-                tensor[10][x][y] = fill_value;
             }
         }
     };
 
     // Start with current board
-    fill_planes(stacked, 0, board, player);
+    fill_planes(0, board);
 
     // Fill history boards in reverse order: T-1, T-2, ...
     for (size_t i = 0; i < 4; ++i) {
         int plane_index = (i + 1) * 2;
-        const auto& hist_board = history[3 - i];
-        fill_planes(stacked, plane_index, hist_board, player);
+        fill_planes(plane_index, history[3 - i]);
     }
 
-    return stacked; 
+    //Current plane: 0 if player 1, 1 if player 2
+    float fill_value = (player == Cell_state::X) ? 0.0f : 1.0f;
+    std::fill(planes + 10 * ROWS * COLS, planes + 11 * ROWS * COLS, fill_value);
 }
 
 
@@ -373,13 +421,19 @@ Cell_state Board::check_winner() const {
 }
 
 torch::Tensor Board::get_legal_mask(Cell_state player) const {
+    torch::Tensor all_moves = torch::empty({policy_size}, torch::kFloat32);
+    write_legal_mask(player, all_moves.data_ptr<float>());
+    return all_moves;
+}
+
+void Board::write_legal_mask(Cell_state player, float* mask) const {
     const int X = 5;
     const int Y = 10;
     const int DIR = 9;
     const int TAR = 4; 
     const int total_size = X * Y * DIR * TAR;
 
-    torch::Tensor all_moves = torch::zeros({total_size}, torch::kFloat32);
+    std::fill(mask, mask + total_size, 0.0f);
 
     // Helper: convert (x,y,dir,tar) → flat index
     auto index = [&](int x, int y, int dir, int tar) -> int {
@@ -394,10 +448,26 @@ torch::Tensor Board::get_legal_mask(Cell_state player) const {
         int idx = index(move[0], move[1], move[2], move[3]);
 
         if (idx >= 0 && idx < total_size)
-            all_moves[idx] = 1.0f;
+            mask[idx] = 1.0f;
     }
+}
 
-    return all_moves;
+int Board::move_to_index(const std::array<int, 4>& move) {
+    const int Y = 10;
+    const int DIR = 9;
+    const int TAR = 4;
+    return move[0] * (Y * DIR * TAR) + move[1] * (DIR * TAR) + (move[2] - 1) * TAR + (move[3] + 1);
+}
+
+std::array<int, 4> Board::index_to_move(int index) {
+    const int Y = 10;
+    const int DIR = 9;
+    const int TAR = 4;
+    int x = index / (Y * DIR * TAR);
+    index %= (Y * DIR * TAR);
+    int y = index / (DIR * TAR);
+    index %= (DIR * TAR);
+    return {x, y, (index / TAR) + 1, (index % TAR) - 1};
 }
 
 void Board::display_board(std::ostream& os) const {
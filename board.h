@@ -2,6 +2,7 @@
 #define BOARD_H
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
@@ -51,6 +52,19 @@ public:
         restricted_move = {-1, -1};
     }
 
+    /**
+     * @brief Zobrist-style 64-bit hash of the game state seen by the network
+     *
+     * Covers the cells, the history planes, the capture path and restricted
+     * move of the turn in progress and the player to move, so two states with
+     * the same hash get the same network evaluation.
+     *
+     * @param player The player to move
+     *
+     * @return Hash of the position
+     */
+    std::uint64_t hash(Cell_state player) const;
+
     /**
      * @brief Getter for the size of the board
      *
@@ -146,6 +160,14 @@ public:
      */
     torch::Tensor to_tensor(Cell_state player) const;
 
+    /**
+     * @brief Writes the planes of to_tensor into a caller-owned buffer
+     *
+     * @param player The current player
+     * @param planes Receives input_size floats, [plane][row][column]
+     */
+    void write_planes(Cell_state player, float* planes) const;
+
     /**
      * @brief Adds the current board state to history
      */
@@ -160,6 +182,42 @@ public:
      */
     torch::Tensor get_legal_mask(Cell_state player) const;
 
+    /**
+     * @brief Writes the mask of get_legal_mask into a caller-owned buffer
+     *
+     * @param player The current player
+     * @param mask Receives policy_size floats
+     */
+    void write_legal_mask(Cell_state player, float* mask) const;
+
+    /**
+     * @brief Size of the network input of a position (11 planes of 5 x 9)
+     */
+    static constexpr int input_size = 11 * 5 * 9;
+
+    /**
+     * @brief Size of the flattened move space used by the policy and the legal mask (5 x 10 x 9 x 4)
+     */
+    static constexpr int policy_size = 1800;
+
+    /**
+     * @brief Converts a move to its index in the flattened policy vector
+     *
+     * @param move Move array {x, y, direction, target}
+     *
+     * @return Index in [0, policy_size)
+     */
+    static int move_to_index(const std::array<int, 4>& move);
+
+    /**
+     * @brief Converts an index of the flattened policy vector back to a move
+     *
+     * @param index Index in [0, policy_size)
+     *
+     * @return Move array {x, y, direction, target}
+     */
+    static std::array<int, 4> index_to_move(int index);
+
     /**
      * @brief Outputs the current state of the board to an output stream
      *
@@ -2,12 +2,16 @@
 #include <chrono>
 #include <thread>
 #include <climits>
+#include <cstdlib>
 #include <random>
 
 #include "board.h"
 #include "mcts_agent.h"
 #include "nn_model.h"
 #include "logger.h"
+#include "self_play.h"
+#include "rng.h"
+#include "thread_config.h"
 
 
 bool is_integer(const std::string& s) {
@@ -113,10 +117,55 @@ std::unique_ptr<Mcts_player> create_mcts_agent(
 
     LogLevel log_level = LogLevel::NONE;
 
-    log_level = static_cast<LogLevel>(get_parameter_within_bounds("Log Level (0:None  -- 5:Full)  : ", 0, 5));
-    return std::make_unique<Mcts_player>(
-        exploration_constant, max_iteration,
-        log_level);
+    if (max_compiled_log_level != LogLevel::NONE) {
+        const int max_log_level = static_cast<int>(max_compiled_log_level);
+        log_level = static_cast<LogLevel>(get_parameter_within_bounds(
+            "Log Level (0:None  -- " + std::to_string(max_log_level) + ":Full)  : ", 0, max_log_level));
+    }
+    if (log_level != LogLevel::NONE &&
+        get_yes_or_no_response("Write the log to a binary trace instead of the console? (y/n): ") == 'y') {
+        Logger::instance(log_level)->start_trace("mcts_trace.bin");
+        std::cout << "Tracing to mcts_trace.bin, print it with: fanorona_trace mcts_trace.bin\n";
+    }
+
+    int num_threads = get_parameter_within_bounds(
+        "Search threads (between 1 and 64): ", 1, 64);
+
+    int time_budget_ms = get_parameter_within_bounds(
+        "Time budget per move in ms (0 for none): ", 0, INT_MAX);
+
+    ParallelMode parallel_mode = ParallelMode::Tree;
+    if (num_threads > 1) {
+        parallel_mode = static_cast<ParallelMode>(get_parameter_within_bounds(
+            "Parallel mode (0: shared tree, 1: independent root searches): ", 0, 1));
+    }
+
+    bool ponder = get_yes_or_no_response("Think during the opponent's turn? (y/n): ") == 'y';
+    bool gumbel_root = get_yes_or_no_response("Gumbel root for small budgets? (y/n): ") == 'y';
+
+    int tree_memory_mib = get_parameter_within_bounds(
+        "Search tree memory cap in MiB (0 to size it from the iterations): ", 0, 1 << 20);
+    TreeMemoryPolicy memory_policy =
+        get_yes_or_no_response("Recycle the least visited subtrees when the tree is full? (y/n): ") == 'y'
+            ? TreeMemoryPolicy::Recycle
+            : TreeMemoryPolicy::Refine;
+    bool dump_tree = get_yes_or_no_response("Dump the search tree of each move to mcts_tree.bin? (y/n): ") == 'y';
+
+    MctsPlayerOptions options;
+    options.num_threads = num_threads;
+    options.time_budget = std::chrono::milliseconds(time_budget_ms);
+    options.early_stop = true;
+    options.ponder = ponder;
+    options.parallel_mode = parallel_mode;
+    options.gumbel_root = gumbel_root;
+    options.max_tree_bytes = static_cast<std::size_t>(tree_memory_mib) << 20;
+    options.memory_policy = memory_policy;
+    auto player = std::make_unique<Mcts_player>(exploration_constant, max_iteration, log_level, options);
+    if (dump_tree) {
+        player->set_tree_export("mcts_tree.bin");
+        std::cout << "Print the last tree with: fanorona_tree mcts_tree.bin [top moves] [depth]\n";
+    }
+    return player;
 }
 
 void countdown(int seconds) {
@@ -177,6 +226,20 @@ void generate_data() {
 
   int cycles = 10;
   int game_counter = 0;
+
+  // Playout cap randomization: a quarter of the moves get the full 1000
+  // simulations and become training samples, the rest are played fast
+  double full_search_probability = 0.25;
+  int cheap_iterations = 100;
+  // Games played at once; their leaf evaluations share one forward pass
+  int concurrent_games = 128;
+  // From the second cycle on, the network can run in INT8, calibrated on the previous replay buffer
+  bool int8_inference = !torch::cuda::is_available() &&
+                        get_yes_or_no_response("INT8 inference for self-play (y/n): ") == 'y';
+  // Otherwise the CPU can skip libtorch for the forward passes
+  bool builtin_engine = !torch::cuda::is_available() && !int8_inference &&
+                        get_yes_or_no_response("Built-in CPU inference engine for self-play (y/n): ") == 'y';
+  GameDataset calibration_positions(data_number);
   for (int iter = 1; iter <= cycles; ++iter) {
 
       GameDataset dataset(data_number);
@@ -186,13 +249,22 @@ void generate_data() {
       std::cout << "🌱 Collecting Data...\n";
 
       // --- 1. SELF-PLAY PHASE ---
-      while (dataset.current_size < data_number) {
-          Game game(9, std::make_unique<Mcts_player>(2, 1000, LogLevel::NONE), std::make_unique<Mcts_player>(2, 1000, LogLevel::NONE), dataset, true);
-          Cell_state winner = game.play();
-          game_counter++;
-          std::cout <<game_counter<<" Games completed - Stored positions: " 
-                    << dataset.current_size << "/"+std::to_string(2048)+" - Player " << winner << " won\n"; 
+      auto network = std::make_shared<NeuralN>("checkpoint/1.pt", torch::kCPU, concurrent_games);
+      if (int8_inference && calibration_positions.current_size > 0) {
+        QuantizationReport report = network->enable_int8(calibration_positions);
+        std::cout << "INT8 layers: " << report.int8_layers.size() << " | Policy KL: " << report.policy_kl
+                  << " | Top-1 agreement: " << 100.0 * report.top1_agreement << "%"
+                  << " | Value error: " << report.value_mean_error << " (max " << report.value_max_error << ")"
+                  << " | Latency: " << report.fp32_latency_us << " -> " << report.int8_latency_us << " us\n";
       }
+      if (builtin_engine) {
+        network->enable_cpu_engine();
+      }
+      SelfPlayDriver driver(network, dataset, concurrent_games, 2, 1000, cheap_iterations, full_search_probability);
+      game_counter += driver.run(data_number);
+      std::cout << game_counter << " Games completed - Stored positions: "
+                << dataset.current_size << "/" << data_number << " - "
+                << driver.average_batch_size() << " positions per forward pass\n";
 
       std::cout << "✅ Replay buffer ready (" 
                 << dataset.current_size << " samples)\n";
@@ -201,6 +273,7 @@ void generate_data() {
       std::cout << "🎯 Training model...\n";
       train(model, dataset, 128, 5, 1e-3, device);
       torch::save(model, "checkpoint/"+std::to_string(iter+2)+".pt");
+      calibration_positions = dataset;
 
   }
 }
@@ -246,6 +319,23 @@ void run_console_interface() {
   print_welcome_ascii_art();
   std::cout << "Hi ;).\n";
 
+  // Thread pools and CPUs, set per process when several self-play processes share a machine
+  try {
+    configure_threads(thread_config_from_env());
+  } catch (const std::exception& e) {
+    std::cerr << "Thread configuration ignored: " << e.what() << "\n";
+  }
+  std::cout << "Inference threads: " << torch::get_num_threads() << " intra-op, "
+            << torch::get_num_interop_threads() << " inter-op"
+            << " (set FANORONA_CPUS, FANORONA_INTRA_OP_THREADS, FANORONA_INTER_OP_THREADS, FANORONA_PIN_SEARCH)\n";
+
+  // Every random stream of the run derives from one seed, printed so that the run can be replayed
+  if (const char* seed = std::getenv("FANORONA_SEED")) {
+    seed_random(std::strtoull(seed, nullptr, 10));
+  }
+  torch::manual_seed(random_seed());
+  std::cout << "Random seed: " << random_seed() << " (set FANORONA_SEED to replay this run)\n";
+
   bool is_running = true;
   while (is_running) {
     try {
@@ -0,0 +1,327 @@
+#include "cpu_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int kHeight = CpuInferenceEngine::kHeight;
+constexpr int kWidth = CpuInferenceEngine::kWidth;
+constexpr int kCells = kHeight * kWidth;
+constexpr int kPaddedWidth = kWidth + 2;
+constexpr int kPaddedCells = (kHeight + 2) * kPaddedWidth;
+
+// Board cells computed together by the vector kernel: a row splits into 3 groups
+constexpr int kCellGroup = 3;
+static_assert(kWidth % kCellGroup == 0, "the convolution kernel walks rows by groups of 3 cells");
+
+int padded_cell(int y, int x) { return (y + 1) * kPaddedWidth + x + 1; }
+
+/**
+ * @brief Activation buffers of one thread, with zero borders
+ */
+struct Scratch {
+    std::vector<float> input;
+    std::vector<float> trunk;
+    std::vector<float> hidden;
+    std::vector<float> next;
+    std::vector<float> planes;
+
+    void reserve(int in_channels, int channels) {
+        const std::size_t trunk_size = static_cast<std::size_t>(kPaddedCells) * channels;
+        if (trunk.size() != trunk_size || input.size() != static_cast<std::size_t>(kPaddedCells) * in_channels) {
+            // Borders are only written here; the kernels write the interior cells
+            input.assign(static_cast<std::size_t>(kPaddedCells) * in_channels, 0.0f);
+            trunk.assign(trunk_size, 0.0f);
+            hidden.assign(trunk_size, 0.0f);
+            next.assign(trunk_size, 0.0f);
+        }
+    }
+};
+
+thread_local Scratch scratch;
+
+void check_size(const std::vector<float>& values, std::size_t expected, const std::string& name) {
+    if (values.size() != expected) {
+        throw std::runtime_error("CpuInferenceEngine: " + name + " has " + std::to_string(values.size()) +
+                                 " values instead of " + std::to_string(expected));
+    }
+}
+
+// [out][in][3][3] -> [tap][in][out]
+std::vector<float> repack_conv3x3(const NetworkWeights::Layer& layer, int in, int out, const std::string& name) {
+    check_size(layer.weight, static_cast<std::size_t>(out) * in * 9, name + ".weight");
+    check_size(layer.bias, out, name + ".bias");
+    std::vector<float> packed(layer.weight.size());
+    for (int o = 0; o < out; ++o) {
+        for (int i = 0; i < in; ++i) {
+            for (int tap = 0; tap < 9; ++tap) {
+                packed[(static_cast<std::size_t>(tap) * in + i) * out + o] = layer.weight[(o * in + i) * 9 + tap];
+            }
+        }
+    }
+    return packed;
+}
+
+/**
+ * @brief out = relu(conv3x3(in) + bias [+ residual]) on the interior cells
+ *
+ * in, out and residual are padded buffers, [cell][channel].
+ */
+void conv3x3_scalar(const float* in, int in_channels, const float* weights, const float* bias, int out_channels,
+                    const float* residual, float* out) {
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+            float* dst = out + static_cast<std::size_t>(padded_cell(y, x)) * out_channels;
+            std::copy(bias, bias + out_channels, dst);
+            for (int ky = 0; ky < 3; ++ky) {
+                for (int kx = 0; kx < 3; ++kx) {
+                    const float* src = in + static_cast<std::size_t>((y + ky) * kPaddedWidth + x + kx) * in_channels;
+                    const float* tap = weights + static_cast<std::size_t>(ky * 3 + kx) * in_channels * out_channels;
+                    for (int i = 0; i < in_channels; ++i) {
+                        const float a = src[i];
+                        const float* w = tap + static_cast<std::size_t>(i) * out_channels;
+                        for (int o = 0; o < out_channels; ++o) {
+                            dst[o] += a * w[o];
+                        }
+                    }
+                }
+            }
+            const float* skip = residual ? residual + static_cast<std::size_t>(padded_cell(y, x)) * out_channels
+                                         : nullptr;
+            for (int o = 0; o < out_channels; ++o) {
+                dst[o] = std::max(0.0f, skip ? dst[o] + skip[o] : dst[o]);
+            }
+        }
+    }
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+void conv3x3_avx2(const float* in, int in_channels, const float* weights, const float* bias, int out_channels,
+                  const float* residual, float* out) {
+    const __m256 zero = _mm256_setzero_ps();
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x0 = 0; x0 < kWidth; x0 += kCellGroup) {
+            for (int o0 = 0; o0 < out_channels; o0 += 32) {
+                // acc[cell][block]: 3 cells by 4 blocks of 8 output channels
+                __m256 acc[kCellGroup][4];
+                for (int j = 0; j < 4; ++j) {
+                    const __m256 b = _mm256_loadu_ps(bias + o0 + 8 * j);
+                    for (int c = 0; c < kCellGroup; ++c) {
+                        acc[c][j] = b;
+                    }
+                }
+
+                for (int ky = 0; ky < 3; ++ky) {
+                    for (int kx = 0; kx < 3; ++kx) {
+                        const float* src =
+                            in + static_cast<std::size_t>((y + ky) * kPaddedWidth + x0 + kx) * in_channels;
+                        const float* tap =
+                            weights + static_cast<std::size_t>(ky * 3 + kx) * in_channels * out_channels + o0;
+                        for (int i = 0; i < in_channels; ++i) {
+                            const float* w = tap + static_cast<std::size_t>(i) * out_channels;
+                            const __m256 w0 = _mm256_loadu_ps(w);
+                            const __m256 w1 = _mm256_loadu_ps(w + 8);
+                            const __m256 w2 = _mm256_loadu_ps(w + 16);
+                            const __m256 w3 = _mm256_loadu_ps(w + 24);
+                            for (int c = 0; c < kCellGroup; ++c) {
+                                const __m256 a = _mm256_broadcast_ss(src + c * in_channels + i);
+                                acc[c][0] = _mm256_fmadd_ps(a, w0, acc[c][0]);
+                                acc[c][1] = _mm256_fmadd_ps(a, w1, acc[c][1]);
+                                acc[c][2] = _mm256_fmadd_ps(a, w2, acc[c][2]);
+                                acc[c][3] = _mm256_fmadd_ps(a, w3, acc[c][3]);
+                            }
+                        }
+                    }
+                }
+
+                for (int c = 0; c < kCellGroup; ++c) {
+                    const std::size_t offset = static_cast<std::size_t>(padded_cell(y, x0 + c)) * out_channels + o0;
+                    for (int j = 0; j < 4; ++j) {
+                        __m256 result = acc[c][j];
+                        if (residual) {
+                            result = _mm256_add_ps(result, _mm256_loadu_ps(residual + offset + 8 * j));
+                        }
+                        _mm256_storeu_ps(out + offset + 8 * j, _mm256_max_ps(result, zero));
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+void conv3x3(const float* in, int in_channels, const float* weights, const float* bias, int out_channels,
+             const float* residual, float* out) {
+#if defined(__AVX2__) && defined(__FMA__)
+    if (out_channels % 32 == 0) {
+        conv3x3_avx2(in, in_channels, weights, bias, out_channels, residual, out);
+        return;
+    }
+#endif
+    conv3x3_scalar(in, in_channels, weights, bias, out_channels, residual, out);
+}
+
+// dst[0..count) += a * row[0..count)
+void axpy(float a, const float* row, float* dst, int count) {
+    int k = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    const __m256 scale = _mm256_set1_ps(a);
+    for (; k + 8 <= count; k += 8) {
+        _mm256_storeu_ps(dst + k, _mm256_fmadd_ps(scale, _mm256_loadu_ps(row + k), _mm256_loadu_ps(dst + k)));
+    }
+#endif
+    for (; k < count; ++k) {
+        dst[k] += a * row[k];
+    }
+}
+
+/**
+ * @brief 1x1 convolution of the trunk into planes, [out][cell] like the flattened PyTorch tensor
+ */
+void conv1x1(const float* trunk, int channels, const float* weights, const float* bias, int out_channels,
+             float* planes) {
+    for (int o = 0; o < out_channels; ++o) {
+        const float* w = weights + static_cast<std::size_t>(o) * channels;
+        for (int y = 0; y < kHeight; ++y) {
+            for (int x = 0; x < kWidth; ++x) {
+                const float* src = trunk + static_cast<std::size_t>(padded_cell(y, x)) * channels;
+                float sum = bias[o];
+                for (int i = 0; i < channels; ++i) {
+                    sum += w[i] * src[i];
+                }
+                planes[o * kCells + y * kWidth + x] = sum;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+CpuInferenceEngine::CpuInferenceEngine(const NetworkWeights& weights)
+    : in_channels(weights.input_channels),
+      channels(weights.channels),
+      moves(weights.num_moves),
+      value_hidden(static_cast<int>(weights.value_fc1.bias.size())),
+      value_fc2_bias(0.0f) {
+    if (weights.height != kHeight || weights.width != kWidth) {
+        throw std::runtime_error("CpuInferenceEngine only runs 5x9 networks");
+    }
+
+    conv_in_weight = repack_conv3x3(weights.conv_in, in_channels, channels, "conv_in");
+    conv_in_bias = weights.conv_in.bias;
+    for (std::size_t i = 0; i < weights.res_convs.size(); ++i) {
+        const std::string name = "res_convs." + std::to_string(i);
+        res_weights.push_back(repack_conv3x3(weights.res_convs[i], channels, channels, name));
+        res_biases.push_back(weights.res_convs[i].bias);
+    }
+    if (res_weights.size() % 2 != 0) {
+        throw std::runtime_error("CpuInferenceEngine: residual blocks need two convolutions each");
+    }
+
+    check_size(weights.policy_head_conv.weight, 2 * static_cast<std::size_t>(channels), "policy_head_conv.weight");
+    check_size(weights.policy_head_conv.bias, 2, "policy_head_conv.bias");
+    check_size(weights.value_head_conv.weight, channels, "value_head_conv.weight");
+    check_size(weights.value_head_conv.bias, 1, "value_head_conv.bias");
+    policy_conv_weight = weights.policy_head_conv.weight;
+    policy_conv_bias = weights.policy_head_conv.bias;
+    value_conv_weight = weights.value_head_conv.weight;
+    value_conv_bias = weights.value_head_conv.bias;
+
+    check_size(weights.policy_fc.weight, static_cast<std::size_t>(moves) * 2 * kCells, "policy_fc.weight");
+    check_size(weights.policy_fc.bias, moves, "policy_fc.bias");
+    policy_fc_weight.resize(weights.policy_fc.weight.size());
+    for (int o = 0; o < moves; ++o) {
+        for (int i = 0; i < 2 * kCells; ++i) {
+            policy_fc_weight[static_cast<std::size_t>(i) * moves + o] =
+                weights.policy_fc.weight[static_cast<std::size_t>(o) * 2 * kCells + i];
+        }
+    }
+    policy_fc_bias = weights.policy_fc.bias;
+
+    check_size(weights.value_fc1.weight, static_cast<std::size_t>(value_hidden) * kCells, "value_fc1.weight");
+    check_size(weights.value_fc2.weight, value_hidden, "value_fc2.weight");
+    check_size(weights.value_fc2.bias, 1, "value_fc2.bias");
+    value_fc1_weight = weights.value_fc1.weight;
+    value_fc1_bias = weights.value_fc1.bias;
+    value_fc2_weight = weights.value_fc2.weight;
+    value_fc2_bias = weights.value_fc2.bias[0];
+}
+
+void CpuInferenceEngine::evaluate(const float* input, const float* legal_mask, int batch, float* policy,
+                                  float* value) const {
+    const std::size_t input_size = static_cast<std::size_t>(in_channels) * kCells;
+    for (int b = 0; b < batch; ++b) {
+        evaluate_one(input + b * input_size, legal_mask ? legal_mask + static_cast<std::size_t>(b) * moves : nullptr,
+                     policy + static_cast<std::size_t>(b) * moves, value + b);
+    }
+}
+
+void CpuInferenceEngine::evaluate_one(const float* input, const float* legal_mask, float* policy,
+                                      float* value) const {
+    scratch.reserve(in_channels, channels);
+
+    // [plane][y][x] -> padded [cell][plane]
+    for (int c = 0; c < in_channels; ++c) {
+        for (int cell = 0; cell < kCells; ++cell) {
+            scratch.input[static_cast<std::size_t>(padded_cell(cell / kWidth, cell % kWidth)) * in_channels + c] =
+                input[c * kCells + cell];
+        }
+    }
+
+    float* trunk = scratch.trunk.data();
+    float* next = scratch.next.data();
+    float* hidden = scratch.hidden.data();
+    conv3x3(scratch.input.data(), in_channels, conv_in_weight.data(), conv_in_bias.data(), channels, nullptr, trunk);
+    for (std::size_t i = 0; i < res_weights.size(); i += 2) {
+        conv3x3(trunk, channels, res_weights[i].data(), res_biases[i].data(), channels, nullptr, hidden);
+        conv3x3(hidden, channels, res_weights[i + 1].data(), res_biases[i + 1].data(), channels, trunk, next);
+        std::swap(trunk, next);
+    }
+
+    // --- Policy Head ---
+    scratch.planes.resize(2 * kCells);
+    float* planes = scratch.planes.data();
+    conv1x1(trunk, channels, policy_conv_weight.data(), policy_conv_bias.data(), 2, planes);
+    std::copy(policy_fc_bias.begin(), policy_fc_bias.end(), policy);
+    for (int i = 0; i < 2 * kCells; ++i) {
+        axpy(planes[i], policy_fc_weight.data() + static_cast<std::size_t>(i) * moves, policy, moves);
+    }
+    if (legal_mask) {
+        for (int m = 0; m < moves; ++m) {
+            if (legal_mask[m] == 0.0f) {
+                policy[m] = -1e9f;
+            }
+        }
+    }
+    const float max_logit = *std::max_element(policy, policy + moves);
+    double sum = 0.0;
+    for (int m = 0; m < moves; ++m) {
+        sum += std::exp(policy[m] - max_logit);
+    }
+    const float log_normalizer = max_logit + static_cast<float>(std::log(sum));
+    for (int m = 0; m < moves; ++m) {
+        policy[m] -= log_normalizer;
+    }
+
+    // --- Value Head ---
+    conv1x1(trunk, channels, value_conv_weight.data(), value_conv_bias.data(), 1, planes);
+    float v = value_fc2_bias;
+    for (int h = 0; h < value_hidden; ++h) {
+        const float* w = value_fc1_weight.data() + static_cast<std::size_t>(h) * kCells;
+        float sum_h = value_fc1_bias[h];
+        for (int cell = 0; cell < kCells; ++cell) {
+            sum_h += w[cell] * planes[cell];
+        }
+        v += value_fc2_weight[h] * std::max(0.0f, sum_h);
+    }
+    *value = std::tanh(v);
+}
@@ -0,0 +1,106 @@
+#ifndef CPU_ENGINE_H
+#define CPU_ENGINE_H
+
+#include <vector>
+
+/**
+ * @brief Weights of an AlphaZeroNetWithMask with BatchNorm folded in, as plain float arrays
+ *
+ * Arrays keep the PyTorch layouts: convolutions are [out][in][kernel][kernel],
+ * linear layers are [out][in], biases are [out]. Produced by
+ * FusedAlphaZeroNet::export_weights.
+ */
+struct NetworkWeights {
+    struct Layer {
+        std::vector<float> weight;
+        std::vector<float> bias;
+    };
+
+    int input_channels = 11;
+    int height = 5;
+    int width = 9;
+    int num_moves = 1800;
+    int channels = 64;
+
+    Layer conv_in;
+    std::vector<Layer> res_convs;  // Two convolutions per residual block
+    Layer policy_head_conv;
+    Layer value_head_conv;
+    Layer policy_fc;
+    Layer value_fc1;
+    Layer value_fc2;
+};
+
+/**
+ * @brief Inference engine for the 5x9 network that does not go through libtorch
+ *
+ * The weights are repacked once into the layouts the kernels read. The
+ * trunk activations live in zero-bordered 7x11 buffers with the channels
+ * innermost, so a 3x3 convolution needs no bounds checks: each output is a
+ * sum over 9 taps of a contiguous channel vector times a contiguous weight
+ * block. With AVX2 and FMA the kernel computes 3 board cells by 32 output
+ * channels at a time in 12 registers (a board row is 3 such cell groups);
+ * otherwise a scalar loop with the same structure runs.
+ *
+ * For one position, the whole cost is the arithmetic of the 13 convolutions
+ * and the policy layer, with no allocation or operator dispatch.
+ * Thread-safe: every thread uses its own scratch buffers.
+ */
+class CpuInferenceEngine {
+public:
+    static constexpr int kHeight = 5;
+    static constexpr int kWidth = 9;
+
+    /**
+     * @brief Repacks the weights of a network
+     *
+     * @param weights Folded weights (see FusedAlphaZeroNet::export_weights)
+     *
+     * @throws std::runtime_error if the network is not a 5x9 one or an array has the wrong size
+     */
+    explicit CpuInferenceEngine(const NetworkWeights& weights);
+
+    /**
+     * @brief Evaluates positions, with the contract of AlphaZeroNetWithMaskImpl::forward
+     *
+     * @param input Positions, [batch][input_channels][5][9] (Board::to_tensor planes)
+     * @param legal_mask Legal move masks, [batch][num_moves] (0 for illegal), or nullptr
+     * @param batch Number of positions
+     * @param policy Receives the policy log-probabilities, [batch][num_moves]
+     * @param value Receives the values, [batch]
+     */
+    void evaluate(const float* input, const float* legal_mask, int batch, float* policy, float* value) const;
+
+    int input_channels() const { return in_channels; }
+    int num_moves() const { return moves; }
+
+private:
+    int in_channels;
+    int channels;
+    int moves;
+    int value_hidden;
+
+    // 3x3 convolutions as [tap][in][out], taps in row-major order
+    std::vector<float> conv_in_weight;
+    std::vector<float> conv_in_bias;
+    std::vector<std::vector<float>> res_weights;
+    std::vector<std::vector<float>> res_biases;
+
+    // 1x1 head convolutions as [out][in]
+    std::vector<float> policy_conv_weight;
+    std::vector<float> policy_conv_bias;
+    std::vector<float> value_conv_weight;
+    std::vector<float> value_conv_bias;
+
+    // Policy layer transposed to [in][out], so each input scales one contiguous row
+    std::vector<float> policy_fc_weight;
+    std::vector<float> policy_fc_bias;
+    std::vector<float> value_fc1_weight;
+    std::vector<float> value_fc1_bias;
+    std::vector<float> value_fc2_weight;
+    float value_fc2_bias;
+
+    void evaluate_one(const float* input, const float* legal_mask, float* policy, float* value) const;
+};
+
+#endif // CPU_ENGINE_H
@@ -0,0 +1,255 @@
+#ifndef EDGE_ARENA_H
+#define EDGE_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include "node_arena.h"
+
+/**
+ * @brief 32-bit index addressing an edge (parent -> child move) inside an EdgeArena
+ */
+using EdgeIndex = std::uint32_t;
+
+/**
+ * @brief Sentinel index meaning "no edge" (the root has no incoming edge)
+ */
+constexpr EdgeIndex kNullEdge = std::numeric_limits<EdgeIndex>::max();
+
+/**
+ * @brief Structure-of-arrays storage for the edges of the search tree
+ *
+ * Every expanded node owns a contiguous range of edges, one per legal move.
+ * The statistics PUCT reads during selection (priors, visit counts and value
+ * sums) are kept in separate flat arrays, so the children of a node can be
+ * scored with SIMD loads instead of chasing one node per child.
+ *
+ * An edge is only 18 bytes: the move is stored as its 16-bit index in the
+ * flattened policy vector, and the child node is created lazily the first
+ * time the edge is selected (kNullNode until then).
+ *
+ * Visit counts and value sums are updated concurrently through
+ * std::atomic_ref with relaxed ordering. Readers take relaxed snapshots:
+ * 32-bit lanes are never torn, and slightly stale statistics only shift
+ * which branch a search thread explores.
+ */
+class EdgeArena {
+public:
+    /**
+     * @brief Constructs an arena able to hold up to capacity edges
+     *
+     * @param capacity Maximum number of edges
+     */
+    explicit EdgeArena(std::size_t capacity = 0)
+        : prior_array(std::make_unique<float[]>(capacity)),
+          visit_array(std::make_unique<std::int32_t[]>(capacity)),
+          value_sum_array(std::make_unique<float[]>(capacity)),
+          move_array(std::make_unique<std::uint16_t[]>(capacity)),
+          child_array(std::make_unique<NodeIndex[]>(capacity)),
+          edge_capacity(capacity),
+          edge_count(0) {}
+
+    /**
+     * @brief Allocates a contiguous range of edges
+     *
+     * @param count Number of edges to allocate
+     *
+     * @return Index of the first edge of the range, or kNullEdge if the arena is full
+     */
+    EdgeIndex allocate(std::size_t count) {
+        std::size_t first = edge_count.load(std::memory_order_relaxed);
+        do {
+            if (count > edge_capacity - first) {
+                return kNullEdge;
+            }
+        } while (!edge_count.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+        return static_cast<EdgeIndex>(first);
+    }
+
+    /**
+     * @brief Initializes an edge with its move and prior, without child node
+     *
+     * @param edge Edge to initialize
+     * @param move_index Index of the move in the flattened policy vector
+     * @param prior Prior probability of the move
+     */
+    void reset(EdgeIndex edge, std::uint16_t move_index, float prior) {
+        prior_array[edge] = prior;
+        visit_array[edge] = 0;
+        value_sum_array[edge] = 0.0f;
+        move_array[edge] = move_index;
+        child_array[edge] = kNullNode;
+    }
+
+    /**
+     * @brief Copies the move and statistics of an edge of another arena, without its child
+     *
+     * @param source Arena holding the edge to copy
+     * @param from Edge to copy in the source arena
+     * @param to Edge to overwrite in this arena
+     */
+    void copy(const EdgeArena& source, EdgeIndex from, EdgeIndex to) {
+        prior_array[to] = source.prior_array[from];
+        visit_array[to] = source.visit_count(from);
+        value_sum_array[to] = source.value_sum(from);
+        move_array[to] = source.move_array[from];
+        child_array[to] = kNullNode;
+    }
+
+    /**
+     * @brief Overwrites the prior of an edge (e.g. to mix exploration noise in)
+     */
+    void set_prior(EdgeIndex edge, float prior) { prior_array[edge] = prior; }
+
+    /**
+     * @brief Attaches a freshly created child node to an edge
+     *
+     * Several threads may try to materialize the child of the same edge; only
+     * the first one succeeds and the others must use the winner's node.
+     *
+     * @param edge Edge whose child is set
+     * @param child Node reached by the move, fully initialized
+     *
+     * @return The child node of the edge after the call
+     */
+    NodeIndex set_child(EdgeIndex edge, NodeIndex child) {
+        NodeIndex expected = kNullNode;
+        if (std::atomic_ref<NodeIndex>(child_array[edge])
+                .compare_exchange_strong(expected, child, std::memory_order_acq_rel)) {
+            return child;
+        }
+        return expected;
+    }
+
+    /**
+     * @brief Atomically adds visits and value to an edge
+     *
+     * @param edge Edge to update
+     * @param visits Visits to add (may be negative to revert a virtual loss)
+     * @param value Value to add to the sum
+     */
+    void add(EdgeIndex edge, std::int32_t visits, float value) {
+        std::atomic_ref<std::int32_t>(visit_array[edge]).fetch_add(visits, std::memory_order_relaxed);
+        std::atomic_ref<float>(value_sum_array[edge]).fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Fixes the value of an edge whose outcome is proven
+     *
+     * The value sum becomes +inf (win) or -inf (loss), so the mean value is
+     * infinite: a lost move is never selected again and a won move is always
+     * preferred. Later additions leave it unchanged.
+     *
+     * @param edge Edge leading to a solved position
+     * @param win Whether the move wins for the player choosing it
+     */
+    void mark_proven(EdgeIndex edge, bool win) {
+        const float infinity = std::numeric_limits<float>::infinity();
+        std::atomic_ref<float>(value_sum_array[edge]).store(win ? infinity : -infinity, std::memory_order_relaxed);
+    }
+
+    std::int32_t visit_count(EdgeIndex edge) const {
+        return std::atomic_ref<std::int32_t>(visit_array[edge]).load(std::memory_order_relaxed);
+    }
+
+    float value_sum(EdgeIndex edge) const {
+        return std::atomic_ref<float>(value_sum_array[edge]).load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Mean value of an edge, 0 when unvisited
+     */
+    float mean_value(EdgeIndex edge) const {
+        std::int32_t visits = visit_count(edge);
+        return visits > 0 ? value_sum(edge) / visits : 0.0f;
+    }
+
+    float prior(EdgeIndex edge) const { return prior_array[edge]; }
+    std::uint16_t move_index(EdgeIndex edge) const { return move_array[edge]; }
+
+    /**
+     * @brief Child node reached by an edge, kNullNode if not materialized yet
+     */
+    NodeIndex child(EdgeIndex edge) const {
+        return std::atomic_ref<NodeIndex>(child_array[edge]).load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Contiguous prior array, for vectorized scans over a range of edges
+     *
+     * Priors are written once when the edges are allocated, before the node
+     * is published, so they can be read without atomics.
+     */
+    const float* priors() const { return prior_array.get(); }
+
+    /**
+     * @brief Copies the statistics of a range of edges into contiguous arrays
+     *
+     * Each value is a relaxed atomic load, so the copy can be scanned with
+     * plain vector loads while other threads keep updating the arena.
+     *
+     * @param first First edge of the range
+     * @param count Number of edges
+     * @param visits Receives the visit counts, count entries
+     * @param value_sums Receives the value sums, count entries
+     */
+    void snapshot(EdgeIndex first, std::uint32_t count, std::int32_t* visits, float* value_sums) const {
+        for (std::uint32_t i = 0; i < count; ++i) {
+            visits[i] = visit_count(first + i);
+            value_sums[i] = value_sum(first + i);
+        }
+    }
+
+    /**
+     * @brief Releases every edge at once
+     */
+    void clear() { edge_count.store(0, std::memory_order_relaxed); }
+
+    /**
+     * @brief Exchanges the contents of two arenas, must not race with allocations
+     */
+    void swap(EdgeArena& other) {
+        prior_array.swap(other.prior_array);
+        visit_array.swap(other.visit_array);
+        value_sum_array.swap(other.value_sum_array);
+        move_array.swap(other.move_array);
+        child_array.swap(other.child_array);
+        std::swap(edge_capacity, other.edge_capacity);
+        std::size_t count = edge_count.load(std::memory_order_relaxed);
+        edge_count.store(other.edge_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.edge_count.store(count, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Number of edges currently allocated
+     */
+    std::size_t size() const { return edge_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Maximum number of edges the arena can hold
+     */
+    std::size_t capacity() const { return edge_capacity; }
+
+    /**
+     * @brief Memory used by the allocated edges in bytes
+     */
+    std::size_t bytes_used() const { return size() * bytes_per_edge; }
+
+    static constexpr std::size_t bytes_per_edge =
+        sizeof(float) + sizeof(std::int32_t) + sizeof(float) + sizeof(std::uint16_t) + sizeof(NodeIndex);
+
+private:
+    std::unique_ptr<float[]> prior_array;
+    std::unique_ptr<std::int32_t[]> visit_array;
+    std::unique_ptr<float[]> value_sum_array;
+    std::unique_ptr<std::uint16_t[]> move_array;
+    std::unique_ptr<NodeIndex[]> child_array;
+    std::size_t edge_capacity;
+    std::atomic<std::size_t> edge_count;
+};
+
+#endif // EDGE_ARENA_H
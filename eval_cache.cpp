@@ -0,0 +1,82 @@
+#include "eval_cache.h"
+
+#include <algorithm>
+
+std::shared_ptr<EvalCache> EvalCache::instance(std::size_t capacity_bytes) {
+    static std::once_flag created;
+    static std::shared_ptr<EvalCache> cache;
+    std::call_once(created, [capacity_bytes]() { cache = std::make_shared<EvalCache>(capacity_bytes); });
+    return cache;
+}
+
+EvalCache::EvalCache(std::size_t capacity_bytes)
+    : shards(num_shards),
+      entries_per_shard(capacity_bytes / (num_shards * sizeof(Entry))),
+      lookup_count(0),
+      hit_count(0) {
+    for (Shard& shard : shards) {
+        // Value-initialized: key 0 marks an empty slot
+        shard.entries = std::make_unique<Entry[]>(entries_per_shard);
+    }
+}
+
+std::pair<EvalCache::Shard*, EvalCache::Entry*> EvalCache::locate(std::uint64_t key) {
+    // Low bits pick the shard, the remaining bits the slot inside it
+    Shard& shard = shards[key % num_shards];
+    Entry& entry = shard.entries[(key / num_shards) % entries_per_shard];
+    return {&shard, &entry};
+}
+
+bool EvalCache::lookup(std::uint64_t key, std::uint64_t network, float& value,
+                       std::vector<std::pair<std::uint16_t, float>>& policy) {
+    if (entries_per_shard == 0) {
+        return false;
+    }
+    lookup_count.fetch_add(1, std::memory_order_relaxed);
+
+    auto [shard, entry] = locate(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    if (entry->key != key || entry->network != network) {
+        return false;
+    }
+
+    value = entry->value;
+    policy.resize(entry->num_moves);
+    for (std::uint16_t i = 0; i < entry->num_moves; ++i) {
+        policy[i] = {entry->move_indices[i], entry->priors[i]};
+    }
+    hit_count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void EvalCache::store(std::uint64_t key, std::uint64_t network, float value,
+                      const std::vector<std::pair<std::uint16_t, float>>& policy) {
+    if (entries_per_shard == 0 || key == 0 || policy.size() > max_moves) {
+        return;
+    }
+
+    auto [shard, entry] = locate(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    entry->key = key;
+    entry->network = network;
+    entry->value = value;
+    entry->num_moves = static_cast<std::uint16_t>(policy.size());
+    for (std::size_t i = 0; i < policy.size(); ++i) {
+        entry->move_indices[i] = policy[i].first;
+        entry->priors[i] = policy[i].second;
+    }
+}
+
+void EvalCache::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::fill_n(shard.entries.get(), entries_per_shard, Entry{});
+    }
+    lookup_count.store(0, std::memory_order_relaxed);
+    hit_count.store(0, std::memory_order_relaxed);
+}
+
+double EvalCache::hit_rate() const {
+    std::size_t total = lookups();
+    return total > 0 ? static_cast<double>(hits()) / total : 0.0;
+}
@@ -0,0 +1,128 @@
+#ifndef EVAL_CACHE_H
+#define EVAL_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Process-wide cache of neural network evaluations
+ *
+ * Maps the hash of a position (see Board::hash) to the value and the sparse
+ * policy (legal move index, prior) returned by the network, so that
+ * transpositions inside a search, repeated openings across games and the two
+ * agents of a self-play game share their evaluations.
+ *
+ * Entries also record the generation of the network that produced them (see
+ * NeuralN::generation): a lookup from another network, or from the same
+ * network after a switch to INT8 or to the built-in engine, misses instead
+ * of returning stale evaluations.
+ *
+ * The memory is fixed at creation: entries live in a direct-mapped table
+ * split into shards, each guarded by its own mutex so concurrent searches
+ * rarely contend. A new evaluation overwrites whatever occupied its slot.
+ * Positions with more than max_moves legal moves are not cached.
+ */
+class EvalCache {
+public:
+    /**
+     * @brief Maximum number of legal moves of a cached position
+     */
+    static constexpr std::size_t max_moves = 64;
+
+    /**
+     * @brief Default memory budget of the process-wide cache
+     */
+    static constexpr std::size_t default_bytes = std::size_t(64) << 20;
+
+    /**
+     * @brief Get or create the process-wide cache
+     *
+     * @param capacity_bytes Memory budget, 0 disables the cache (only used on first call)
+     *
+     * @return Shared pointer to the cache
+     */
+    static std::shared_ptr<EvalCache> instance(std::size_t capacity_bytes = default_bytes);
+
+    /**
+     * @brief Constructs a cache using at most capacity_bytes for its entries
+     *
+     * @param capacity_bytes Memory budget, 0 disables the cache
+     */
+    explicit EvalCache(std::size_t capacity_bytes);
+
+    /**
+     * @brief Looks up the evaluation of a position
+     *
+     * @param key Hash of the position
+     * @param network Generation of the network asking
+     * @param value Receives the cached value
+     * @param policy Receives the cached (move index, prior) pairs
+     *
+     * @return True on a hit by the same network generation
+     */
+    bool lookup(std::uint64_t key, std::uint64_t network, float& value,
+                std::vector<std::pair<std::uint16_t, float>>& policy);
+
+    /**
+     * @brief Stores the evaluation of a position
+     *
+     * @param key Hash of the position
+     * @param network Generation of the network that evaluated the position
+     * @param value Value returned by the network
+     * @param policy (move index, prior) pair of every legal move
+     */
+    void store(std::uint64_t key, std::uint64_t network, float value,
+               const std::vector<std::pair<std::uint16_t, float>>& policy);
+
+    /**
+     * @brief Forgets every entry and resets the counters
+     */
+    void clear();
+
+    std::size_t lookups() const { return lookup_count.load(std::memory_order_relaxed); }
+    std::size_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Fraction of lookups answered from the cache
+     */
+    double hit_rate() const;
+
+    /**
+     * @brief Number of entries the cache can hold
+     */
+    std::size_t capacity() const { return shards.size() * entries_per_shard; }
+
+private:
+    struct Entry {
+        std::uint64_t key;
+        std::uint64_t network;
+        float value;
+        std::uint16_t num_moves;
+        std::uint16_t move_indices[max_moves];
+        float priors[max_moves];
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unique_ptr<Entry[]> entries;
+    };
+
+    static constexpr std::size_t num_shards = 64;
+
+    std::vector<Shard> shards;
+    std::size_t entries_per_shard;
+    std::atomic<std::size_t> lookup_count;
+    std::atomic<std::size_t> hit_count;
+
+    /**
+     * @brief Shard and slot of a key
+     */
+    std::pair<Shard*, Entry*> locate(std::uint64_t key);
+};
+
+#endif // EVAL_CACHE_H
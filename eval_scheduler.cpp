@@ -0,0 +1,173 @@
+#include "eval_scheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "thread_config.h"
+
+void SearchTask::promise_type::unhandled_exception() {
+    scheduler->record_failure(std::current_exception());
+}
+
+void SearchTask::promise_type::finish(std::coroutine_handle<promise_type> handle) noexcept {
+    EvalScheduler* scheduler = handle.promise().scheduler;
+    handle.destroy();
+    scheduler->task_finished();
+}
+
+EvalScheduler::EvalScheduler(std::shared_ptr<NeuralN> network, std::size_t max_batch, int num_threads)
+    : network(std::move(network)),
+      max_batch(std::max<std::size_t>(1, max_batch)),
+      num_threads(std::max(1, num_threads)),
+      live_tasks(0),
+      resuming_threads(0),
+      batch_running(false),
+      has_failed(false),
+      batch_count(0),
+      evaluation_count(0) {}
+
+void EvalScheduler::Evaluation::await_suspend(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+    scheduler.pending.emplace_back(this, handle);
+    if (scheduler.pending.size() >= scheduler.max_batch) {
+        scheduler.wakeup.notify_all();
+    }
+}
+
+EvalScheduler::EvaluationResult EvalScheduler::Evaluation::await_resume() {
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return {std::move(priors), value, batch_size};
+}
+
+void EvalScheduler::NextBatch::await_suspend(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+    scheduler.batch_waiters.push_back(handle);
+}
+
+void EvalScheduler::spawn(SearchTask task) {
+    std::coroutine_handle<SearchTask::promise_type> handle = std::exchange(task.handle, nullptr);
+    handle.promise().scheduler = this;
+    std::lock_guard<std::mutex> lock(mutex);
+    live_tasks++;
+    ready.push_back(handle);
+    wakeup.notify_one();
+}
+
+void EvalScheduler::run() {
+    std::vector<std::thread> helpers;
+    helpers.reserve(num_threads - 1);
+    for (int i = 1; i < num_threads; ++i) {
+        helpers.emplace_back([this, i]() {
+            pin_search_thread(i);
+            work();
+        });
+    }
+    work();
+    for (auto& thread : helpers) {
+        thread.join();
+    }
+
+    std::exception_ptr error = std::exchange(failure, nullptr);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void EvalScheduler::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (!ready.empty()) {
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            resuming_threads++;
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            resuming_threads--;
+            if (resuming_threads == 0) {
+                wakeup.notify_all();  // Every coroutine may now be parked: time for a batch
+            }
+            continue;
+        }
+
+        // Batch once no other thread can add requests, or when the batch is full
+        if (!pending.empty() && !batch_running && (resuming_threads == 0 || pending.size() >= max_batch)) {
+            const std::size_t size = std::min(max_batch, pending.size());
+            std::vector<std::pair<Evaluation*, std::coroutine_handle<>>> batch(pending.begin(),
+                                                                                pending.begin() + size);
+            pending.erase(pending.begin(), pending.begin() + size);
+            batch_running = true;
+            lock.unlock();
+            evaluate_batch(batch);
+            lock.lock();
+            batch_running = false;
+            batch_count++;
+            evaluation_count += batch.size();
+            for (const auto& [evaluation, handle] : batch) {
+                ready.push_back(handle);
+            }
+            ready.insert(ready.end(), batch_waiters.begin(), batch_waiters.end());
+            batch_waiters.clear();
+            wakeup.notify_all();
+            continue;
+        }
+
+        if (live_tasks == 0) {
+            wakeup.notify_all();
+            return;
+        }
+        if (pending.empty() && !batch_running && resuming_threads == 0 && !batch_waiters.empty()) {
+            // Nothing left to evaluate: the awaited expansions are done
+            ready.insert(ready.end(), batch_waiters.begin(), batch_waiters.end());
+            batch_waiters.clear();
+            continue;
+        }
+        wakeup.wait(lock);
+    }
+}
+
+void EvalScheduler::evaluate_batch(const std::vector<std::pair<Evaluation*, std::coroutine_handle<>>>& batch) {
+    try {
+        BufferLease lease = network->buffers(batch.size());
+        InferenceBuffers& buffers = *lease;
+        for (std::size_t k = 0; k < batch.size(); ++k) {
+            const EvaluationRequest& request = batch[k].first->request;
+            std::copy(request.input.begin(), request.input.end(), buffers.input(k));
+            std::copy(request.legal_mask.begin(), request.legal_mask.end(), buffers.legal_mask(k));
+        }
+
+        network->evaluate(buffers, batch.size());
+        // The rows go back to the pool with the lease: read them before resuming anyone
+        for (std::size_t k = 0; k < batch.size(); ++k) {
+            batch[k].first->priors = Mcts_agent::sparse_policy(buffers.policy(k));
+            batch[k].first->value = buffers.value(k);
+            batch[k].first->batch_size = batch.size();
+        }
+    } catch (...) {
+        for (const auto& [evaluation, handle] : batch) {
+            evaluation->error = std::current_exception();
+        }
+    }
+}
+
+void EvalScheduler::task_finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    live_tasks--;
+    if (live_tasks == 0) {
+        wakeup.notify_all();
+    }
+}
+
+void EvalScheduler::record_failure(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!failure) {
+        failure = error;
+    }
+    has_failed.store(true, std::memory_order_release);
+    // Coroutines parked on the next batch check the failure when they resume
+    ready.insert(ready.end(), batch_waiters.begin(), batch_waiters.end());
+    batch_waiters.clear();
+    wakeup.notify_all();
+}
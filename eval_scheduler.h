@@ -0,0 +1,250 @@
+#ifndef EVAL_SCHEDULER_H
+#define EVAL_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "mcts_agent.h"
+
+class EvalScheduler;
+
+/**
+ * @brief Coroutine running search work on an EvalScheduler
+ *
+ * Created suspended; EvalScheduler::spawn takes ownership and schedules it.
+ * The coroutine frame is destroyed as soon as the body returns.
+ */
+class SearchTask {
+public:
+    struct promise_type {
+        EvalScheduler* scheduler = nullptr;
+
+        SearchTask get_return_object() {
+            return SearchTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept { finish(handle); }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        void unhandled_exception();
+
+        /**
+         * @brief Destroys a finished coroutine and tells its scheduler
+         */
+        static void finish(std::coroutine_handle<promise_type> handle) noexcept;
+    };
+
+    SearchTask(SearchTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    SearchTask(const SearchTask&) = delete;
+    SearchTask& operator=(const SearchTask&) = delete;
+    SearchTask& operator=(SearchTask&&) = delete;
+
+    /**
+     * @brief Destroys the coroutine if it was never spawned
+     */
+    ~SearchTask() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+private:
+    friend class EvalScheduler;
+
+    explicit SearchTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * @brief Runs search coroutines on a few threads and batches their network evaluations
+ *
+ * Simulations co_await evaluate() instead of calling the network: the
+ * coroutine is parked with its request and the thread moves on to other
+ * simulations, of the same tree or of other games. Once every runnable
+ * coroutine is parked (or max_batch requests are waiting) one thread runs a
+ * single batched forward pass and the parked coroutines are resumed with
+ * their row of the result.
+ */
+class EvalScheduler {
+public:
+    /**
+     * @brief Constructs a scheduler evaluating positions with a network
+     *
+     * @param network Network evaluating the batches
+     * @param max_batch Maximum number of positions per forward pass
+     * @param num_threads Threads resuming coroutines while run() is active, the caller included
+     */
+    EvalScheduler(std::shared_ptr<NeuralN> network, std::size_t max_batch, int num_threads = 1);
+
+    EvalScheduler(const EvalScheduler&) = delete;
+    EvalScheduler& operator=(const EvalScheduler&) = delete;
+
+    /**
+     * @brief Output of the network for one position
+     */
+    struct EvaluationResult {
+        std::vector<std::pair<std::uint16_t, float>> priors;  // See Mcts_agent::sparse_policy
+        float value;
+        std::size_t batch_size;  // Positions of the forward pass that evaluated it
+    };
+
+    /**
+     * @brief Awaitable network evaluation of one position
+     *
+     * Resumes with the priors of the legal moves, the value of the position
+     * and the size of the batch; rethrows in the coroutine if the forward
+     * pass failed. The network input is written once, into the awaiter kept
+     * in the coroutine frame.
+     */
+    class Evaluation {
+    public:
+        Evaluation(EvalScheduler& scheduler, const Board& board, Cell_state player)
+            : scheduler(scheduler), value(0.0f), batch_size(0) {
+            request.fill(board, player);
+        }
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        EvaluationResult await_resume();
+
+    private:
+        friend class EvalScheduler;
+
+        EvalScheduler& scheduler;
+        EvaluationRequest request;
+        std::vector<std::pair<std::uint16_t, float>> priors;
+        float value;
+        std::size_t batch_size;
+        std::exception_ptr error;
+    };
+
+    /**
+     * @brief Awaitable resuming after the next forward pass completes
+     *
+     * Used by a simulation reaching a leaf that another simulation is
+     * evaluating: the thread is not blocked while the evaluation is pending.
+     */
+    class NextBatch {
+    public:
+        explicit NextBatch(EvalScheduler& scheduler) : scheduler(scheduler) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+    private:
+        EvalScheduler& scheduler;
+    };
+
+    /**
+     * @brief Evaluates a position with the next batch
+     *
+     * @param board Position to evaluate
+     * @param player Player to move
+     *
+     * @return Awaitable yielding an EvaluationResult
+     */
+    Evaluation evaluate(const Board& board, Cell_state player) { return Evaluation(*this, board, player); }
+
+    /**
+     * @brief Suspends the awaiting coroutine until the next batch has been evaluated
+     */
+    NextBatch next_batch() { return NextBatch(*this); }
+
+    /**
+     * @brief Schedules a coroutine, which the scheduler then owns
+     *
+     * May be called before run() or from a running coroutine.
+     *
+     * @param task Coroutine to run
+     */
+    void spawn(SearchTask task);
+
+    /**
+     * @brief Runs the spawned coroutines until all of them have returned
+     *
+     * @throws The first exception that escaped a coroutine or a forward pass
+     */
+    void run();
+
+    /**
+     * @brief Number of forward passes run so far
+     */
+    std::size_t batches() const { return batch_count; }
+
+    /**
+     * @brief Number of positions evaluated so far
+     */
+    std::size_t evaluations() const { return evaluation_count; }
+
+    /**
+     * @brief Whether a coroutine or a forward pass failed; the coroutines then stop
+     *
+     * run() rethrows the failure once they have all returned.
+     */
+    bool failed() const { return has_failed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Largest number of positions in one forward pass
+     */
+    std::size_t batch_capacity() const { return max_batch; }
+
+private:
+    friend struct SearchTask::promise_type;
+
+    std::shared_ptr<NeuralN> network;
+    std::size_t max_batch;
+    int num_threads;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<std::pair<Evaluation*, std::coroutine_handle<>>> pending;
+    std::vector<std::coroutine_handle<>> batch_waiters;
+    std::size_t live_tasks;
+    int resuming_threads;
+    bool batch_running;
+    std::exception_ptr failure;
+    std::atomic<bool> has_failed;
+    std::size_t batch_count;
+    std::size_t evaluation_count;
+
+    /**
+     * @brief Loop of a thread of run(): resumes coroutines and runs batches until every task returned
+     */
+    void work();
+
+    /**
+     * @brief Evaluates a batch outside the lock and stores each result in its awaitable
+     */
+    void evaluate_batch(const std::vector<std::pair<Evaluation*, std::coroutine_handle<>>>& batch);
+
+    /**
+     * @brief Called when a coroutine returns
+     */
+    void task_finished();
+
+    /**
+     * @brief Keeps the first exception that escaped a coroutine
+     */
+    void record_failure(std::exception_ptr error);
+};
+
+#endif // EVAL_SCHEDULER_H
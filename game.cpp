@@ -7,13 +7,14 @@
 #include <iostream>
 #include <random>
 
-
-static std::mt19937 random_generator(std::random_device{}());
+#include "rng.h"
 
 
 Game::Game(int board_size, std::unique_ptr<Player> player1,
-           std::unique_ptr<Player> player_2, GameDataset& dataset, bool verbose)
-    : board(board_size), current_player_index(0), dataset_(dataset), verbose(verbose) {
+           std::unique_ptr<Player> player_2, GameDataset& dataset, bool verbose,
+           double full_search_probability)
+    : board(board_size), current_player_index(0), dataset_(dataset), verbose(verbose),
+      full_search_probability(full_search_probability) {
   players[0] = std::move(player1);
   players[1] = std::move(player_2);
 }
@@ -41,10 +42,14 @@ Cell_state Game::play() {
         Cell_state current_player =
             current_player_index == 0 ? Cell_state::X : Cell_state::O;
 
+        // Playout cap randomization: only full searches give policy targets
+        bool full_search = std::bernoulli_distribution(full_search_probability)(thread_random());
+        players[current_player_index]->set_full_search(full_search);
+
         // board.display_board(std::cout);
         auto [chosen_move, logits] = players[current_player_index]->choose_move(board, current_player);
-        // Skip if random move or human move
-        if (logits.numel() > 1000) {
+        // Skip if random move or human move, or if the search was a cheap one
+        if (full_search && logits.numel() > 1000) {
             auto board_tensor = board.to_tensor(current_player);
             auto pi_tensor = logits;
             auto mask_tensor = board.get_legal_mask(current_player);  
@@ -179,7 +184,7 @@ void Game::random_move(int random_move_number) {
         }
 
         std::uniform_int_distribution<> dist(0, static_cast<int>(valid_moves.size() - 1));
-        const std::array<int, 4>& random_move = valid_moves[dist(random_generator)];
+        const std::array<int, 4>& random_move = valid_moves[dist(thread_random())];
 
         board.make_move(random_move[0], random_move[1],
                         random_move[2], random_move[3], player);
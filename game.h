@@ -30,10 +30,13 @@ class Game {
    * @param player_2 Unique pointer to the second player.
    * @param dataset Reference to the game dataset for storing game data.
    * @param verbose Flag to enable verbose output (default: false).
+   * @param full_search_probability Fraction of self-play moves searched in full and recorded;
+   *        the other moves use a cheap search and are not recorded (default: 1, every move).
    */
   Game(int board_size, std::unique_ptr<Player> player_1,
        std::unique_ptr<Player> player_2,
-       GameDataset& dataset, bool verbose = false);
+       GameDataset& dataset, bool verbose = false,
+       double full_search_probability = 1.0);
 
   /**
    * @brief Converts a move array to its string representation.
@@ -68,6 +71,7 @@ class Game {
   std::vector<torch::Tensor> result_z;
   GameDataset& dataset_;
   bool verbose = true;
+  double full_search_probability;
 
   /**
    * @brief Switches the current player.
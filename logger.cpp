@@ -1,5 +1,8 @@
 #include "logger.h"
 
+#include <algorithm>
+#include <cmath>
+
 // Initialize static member
 std::shared_ptr<Logger> Logger::logger = nullptr;
 
@@ -18,74 +21,83 @@ void Logger::log(const std::string& message) {
 }
 
 bool Logger::should_log(LogLevel required_level) const {
-    return static_cast<int>(log_level) >= static_cast<int>(required_level);
+    return log_compiled(required_level) && static_cast<int>(log_level) >= static_cast<int>(required_level);
+}
+
+TraceEvent Logger::make_event(TraceEventType type, const std::array<int, 4>& move) {
+    TraceEvent event{};
+    event.type = type;
+    for (int i = 0; i < 4; ++i) {
+        event.move[i] = static_cast<std::int8_t>(move[i]);
+    }
+    return event;
+}
+
+void Logger::emit(const TraceEvent& event) {
+    if (trace) {
+        trace->record(event);
+    } else {
+        log(format_event(event));
+    }
+}
+
+void Logger::start_trace(const std::string& path) {
+    trace.reset();
+    trace = std::make_unique<TraceWriter>(path);
 }
 
 void Logger::log_mcts_start(Cell_state player) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        std::ostringstream message;
-        message << "\n=============MCTS START - " << player
-                << " to move=============\n";
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::MctsStart);
+        event.player = static_cast<std::uint8_t>(player);
+        emit(event);
     }
 }
 
 void Logger::log_mcts_end() {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        log("\n=============MCTS END=============\n");
+        emit(make_event(TraceEventType::MctsEnd));
     }
 }
 
 void Logger::log_iteration_number(int iteration_number) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        std::ostringstream message;
-        message << "\n--- ITERATION " << iteration_number << " ---\n";
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::IterationNumber);
+        event.numbers.counts[0] = iteration_number;
+        emit(event);
     }
 }
 
 void Logger::log_step(const std::string& step_name, const std::array<int, 4>& move) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-      std::ostringstream message;
-      if (move[0]<0){
-        message << "[" << step_name << "] Node: ROOT";
-      }
-      else{
-        message << "[" << step_name << "] Node: " << print_move(move);
-        
-      }
-      log(message.str());
+        TraceEvent event = make_event(TraceEventType::Step, move);
+        step_name.copy(event.label, sizeof(event.label) - 1);
+        emit(event);
     }
 }
 
 void Logger::log_nn_evaluation(const std::array<int, 4>& move, float value_from_nn, int num_legal_moves) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        std::ostringstream message;
-        message << "[EVALUATION]" <<" Value from NN=" << std::fixed << std::setprecision(2) 
-                << value_from_nn << ", Number of Legal Moves=" << num_legal_moves;
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::NnEvaluation, move);
+        event.numbers.values[0] = value_from_nn;
+        event.numbers.counts[0] = num_legal_moves;
+        emit(event);
     }
 }
 
 void Logger::log_expansion(const std::array<int, 4>& move, int num_children) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        std::ostringstream message;
-        message << "  Inititalized " << print_move(move) << " with " 
-                << num_children << " children";
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::Expansion, move);
+        event.numbers.counts[0] = num_children;
+        emit(event);
     }
 }
 
 void Logger::log_selected_child(const std::array<int, 4>& move, double puct_score) {
     if (should_log(LogLevel::SELECTION_ONLY)) {
-        std::ostringstream message;
-        message << "  Selected: " << print_move(move) << " | PUCT=";
-        if (puct_score == std::numeric_limits<double>::max()) {
-            message << "inf";
-        } else {
-            message << std::fixed << std::setprecision(4) << puct_score;
-        }
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::SelectedChild, move);
+        event.numbers.score = puct_score;
+        emit(event);
     }
 }
 
@@ -97,70 +109,80 @@ void Logger::log_puct_details(const std::array<int, 4>& move, float q_value,
     if (std::isnan(u_value)) u_value = 0.0f;
 
     if (should_log(LogLevel::EVERYTHING)) {
-        std::ostringstream message;
-        message << "    " << print_move(move) << ": Q=" << std::fixed << std::setprecision(2) << q_value
-                << ", U=" << std::setprecision(2) << u_value
-                << ", P=" << std::setprecision(2) << prior
-                << ", N=" << visits << "/" << parent_visits;
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::PuctDetails, move);
+        event.numbers.values[0] = q_value;
+        event.numbers.values[1] = u_value;
+        event.numbers.values[2] = prior;
+        event.numbers.counts[0] = visits;
+        event.numbers.counts[1] = parent_visits;
+        emit(event);
     }
 }
 
 void Logger::log_simulation_start(const std::array<int, 4>& move, const Board& board) {
     if (should_log(LogLevel::EVERYTHING)) {
-        std::ostringstream message;
-        std::ostringstream board_string;
-        board.display_board(board_string);
-        message << "\n  Random playout from " << print_move(move) 
-                << ":\n" << board_string.str();
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::SimulationStart, move);
+        if (trace) {
+            // The board is not traced
+            trace->record(event);
+        } else {
+            std::ostringstream board_string;
+            board.display_board(board_string);
+            log(format_event(event) + board_string.str());
+        }
     }
 }
 
 void Logger::log_simulation_step(Cell_state current_player, const Board& board,
                                  const std::array<int, 4>& move) {
     if (should_log(LogLevel::EVERYTHING)) {
-        std::ostringstream message;
-        message << "    " << current_player << " plays " << print_move(move);
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::SimulationStep, move);
+        event.player = static_cast<std::uint8_t>(current_player);
+        emit(event);
     }
 }
 
 void Logger::log_simulation_end(float value) {
     if (should_log(LogLevel::EVERYTHING)) {
-        std::ostringstream message;
-        message << "  Playout result: " << std::fixed << std::setprecision(2) << value;
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::SimulationEnd);
+        event.numbers.values[0] = value;
+        emit(event);
     }
 }
 
 void Logger::log_backpropagation_start(const std::array<int, 4>& move, float value) {
     if (should_log(LogLevel::BACKPROP_ONLY)) {
-        std::ostringstream message;
-        message << "  Backprop value=" << std::fixed << std::setprecision(2) 
-                << value << " from " << print_move(move);
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::BackpropagationStart, move);
+        event.numbers.values[0] = value;
+        emit(event);
     }
 }
 
 void Logger::log_backpropagation_result(const std::array<int, 4>& move,
                                        float acc_value, int visit_count) {
     if (should_log(LogLevel::BACKPROP_ONLY)) {
-        std::ostringstream message;
-        message << "    " << print_move(move) << ": Visits=" << visit_count
-                << ",| Acc Value=" << std::fixed << std::setprecision(2) << acc_value
-                << ",| Mean Value=" << std::setprecision(2) << acc_value/visit_count;
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::BackpropagationResult, move);
+        event.numbers.values[0] = acc_value;
+        event.numbers.counts[0] = visit_count;
+        emit(event);
     }
 }
 
 void Logger::log_root_stats(int visit_count, size_t child_nodes) {
     if (should_log(LogLevel::ROOT_STATS)) {
-        std::ostringstream message;
-        message << "\n--- ROOT STATISTICS ---\n"
-                << "Total visits: " << visit_count
-                << " | Children: " << child_nodes << "\n";
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::RootStats);
+        event.numbers.counts[0] = visit_count;
+        event.numbers.counts[1] = static_cast<std::int64_t>(child_nodes);
+        emit(event);
+    }
+}
+
+void Logger::log_cache_stats(size_t hits, size_t lookups) {
+    if (should_log(LogLevel::ROOT_STATS)) {
+        TraceEvent event = make_event(TraceEventType::CacheStats);
+        event.numbers.counts[0] = static_cast<std::int64_t>(hits);
+        event.numbers.counts[1] = static_cast<std::int64_t>(lookups);
+        emit(event);
     }
 }
 
@@ -168,22 +190,19 @@ void Logger::log_child_node_stats(const std::array<int, 4>& move,
                                   float acc_value, int visit_count, 
                                   float prior_proba) {
     if (should_log(LogLevel::ROOT_STATS)) {
-        std::ostringstream message;
-        message << "  " << print_move(move)
-                << " | Visits: " << visit_count
-                << " | Prior: " << std::fixed << std::setprecision(2) << prior_proba
-                << " | Mean Value: " << std::setprecision(2) << acc_value/visit_count
-                << " | Acc Value: " << std::setprecision(2) << acc_value;
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::ChildNodeStats, move);
+        event.numbers.values[0] = acc_value;
+        event.numbers.values[1] = prior_proba;
+        event.numbers.counts[0] = visit_count;
+        emit(event);
     }
 }
 
 void Logger::log_timer_ran_out(int iteration_counter) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        std::ostringstream message;
-        message << "\n--- Completed " << iteration_counter 
-                << " iterations. Selecting best move ---\n";
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::TimerRanOut);
+        event.numbers.counts[0] = iteration_counter;
+        emit(event);
     }
 }
 
@@ -191,24 +210,126 @@ void Logger::log_best_child_chosen(int iteration_counter,
                                    const std::array<int, 4>& move,
                                    float avg_value, int visits) {
     if (should_log(LogLevel::STEPS_ONLY)) {
-        std::ostringstream message;
-        message << "\n>>> FINAL CHOICE: " << print_move(move)
-                << " | Visits: " << visits
-                << " | Avg Value: " << std::fixed << std::setprecision(2) << avg_value
-                << " | After " << iteration_counter << " iterations\n";
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::BestChildChosen, move);
+        event.numbers.values[0] = avg_value;
+        event.numbers.counts[0] = iteration_counter;
+        event.numbers.counts[1] = visits;
+        emit(event);
     }
 }
 
 void Logger::log_dirichlet_noise_applied(float alpha, float exploration_fraction) {
     if (should_log(LogLevel::EVERYTHING)) {
-        std::ostringstream message;
-        message << "  Applied Dirichlet noise: alpha=" << std::fixed 
-                << std::setprecision(2) << alpha
-                << ", exploration_fraction=" << std::setprecision(2) 
-                << exploration_fraction;
-        log(message.str());
+        TraceEvent event = make_event(TraceEventType::DirichletNoiseApplied);
+        event.numbers.values[0] = alpha;
+        event.numbers.values[1] = exploration_fraction;
+        emit(event);
+    }
+}
+
+std::string Logger::format_event(const TraceEvent& event) {
+    const std::array<int, 4> move = {event.move[0], event.move[1], event.move[2], event.move[3]};
+    const TraceNumbers& numbers = event.numbers;
+    std::ostringstream message;
+    switch (event.type) {
+        case TraceEventType::MctsStart:
+            message << "\n=============MCTS START - " << static_cast<Cell_state>(event.player)
+                    << " to move=============\n";
+            break;
+        case TraceEventType::MctsEnd:
+            message << "\n=============MCTS END=============\n";
+            break;
+        case TraceEventType::IterationNumber:
+            message << "\n--- ITERATION " << numbers.counts[0] << " ---\n";
+            break;
+        case TraceEventType::Step: {
+            const std::string step_name(event.label,
+                                        std::find(event.label, event.label + sizeof(event.label), '\0'));
+            if (move[0] < 0) {
+                message << "[" << step_name << "] Node: ROOT";
+            } else {
+                message << "[" << step_name << "] Node: " << print_move(move);
+            }
+            break;
+        }
+        case TraceEventType::NnEvaluation:
+            message << "[EVALUATION]" << " Value from NN=" << std::fixed << std::setprecision(2)
+                    << numbers.values[0] << ", Number of Legal Moves=" << numbers.counts[0];
+            break;
+        case TraceEventType::Expansion:
+            message << "  Inititalized " << print_move(move) << " with "
+                    << numbers.counts[0] << " children";
+            break;
+        case TraceEventType::SelectedChild:
+            message << "  Selected: " << print_move(move) << " | PUCT=";
+            if (numbers.score == std::numeric_limits<double>::max()) {
+                message << "inf";
+            } else {
+                message << std::fixed << std::setprecision(4) << numbers.score;
+            }
+            break;
+        case TraceEventType::PuctDetails:
+            message << "    " << print_move(move) << ": Q=" << std::fixed << std::setprecision(2) << numbers.values[0]
+                    << ", U=" << std::setprecision(2) << numbers.values[1]
+                    << ", P=" << std::setprecision(2) << numbers.values[2]
+                    << ", N=" << numbers.counts[0] << "/" << numbers.counts[1];
+            break;
+        case TraceEventType::SimulationStart:
+            message << "\n  Random playout from " << print_move(move) << ":\n";
+            break;
+        case TraceEventType::SimulationStep:
+            message << "    " << static_cast<Cell_state>(event.player) << " plays " << print_move(move);
+            break;
+        case TraceEventType::SimulationEnd:
+            message << "  Playout result: " << std::fixed << std::setprecision(2) << numbers.values[0];
+            break;
+        case TraceEventType::BackpropagationStart:
+            message << "  Backprop value=" << std::fixed << std::setprecision(2)
+                    << numbers.values[0] << " from " << print_move(move);
+            break;
+        case TraceEventType::BackpropagationResult:
+            message << "    " << print_move(move) << ": Visits=" << numbers.counts[0]
+                    << ",| Acc Value=" << std::fixed << std::setprecision(2) << numbers.values[0]
+                    << ",| Mean Value=" << std::setprecision(2) << numbers.values[0] / numbers.counts[0];
+            break;
+        case TraceEventType::RootStats:
+            message << "\n--- ROOT STATISTICS ---\n"
+                    << "Total visits: " << numbers.counts[0]
+                    << " | Children: " << numbers.counts[1] << "\n";
+            break;
+        case TraceEventType::CacheStats:
+            message << "Eval cache: " << numbers.counts[0] << "/" << numbers.counts[1] << " hits ("
+                    << std::fixed << std::setprecision(1)
+                    << (numbers.counts[1] > 0 ? 100.0 * numbers.counts[0] / numbers.counts[1] : 0.0) << "%)\n";
+            break;
+        case TraceEventType::ChildNodeStats:
+            message << "  " << print_move(move)
+                    << " | Visits: " << numbers.counts[0]
+                    << " | Prior: " << std::fixed << std::setprecision(2) << numbers.values[1]
+                    << " | Mean Value: " << std::setprecision(2) << numbers.values[0] / numbers.counts[0]
+                    << " | Acc Value: " << std::setprecision(2) << numbers.values[0];
+            break;
+        case TraceEventType::TimerRanOut:
+            message << "\n--- Completed " << numbers.counts[0]
+                    << " iterations. Selecting best move ---\n";
+            break;
+        case TraceEventType::BestChildChosen:
+            message << "\n>>> FINAL CHOICE: " << print_move(move)
+                    << " | Visits: " << numbers.counts[1]
+                    << " | Avg Value: " << std::fixed << std::setprecision(2) << numbers.values[0]
+                    << " | After " << numbers.counts[0] << " iterations\n";
+            break;
+        case TraceEventType::DirichletNoiseApplied:
+            message << "  Applied Dirichlet noise: alpha=" << std::fixed
+                    << std::setprecision(2) << numbers.values[0]
+                    << ", exploration_fraction=" << std::setprecision(2)
+                    << numbers.values[1];
+            break;
+        case TraceEventType::Dropped:
+            message << "[TRACE] " << numbers.counts[0] << " events dropped: the writer fell behind";
+            break;
     }
+    return message.str();
 }
 
 std::string Logger::print_move(std::array<int, 4> move) {
@@ -11,6 +11,7 @@
 #include <limits>
 
 #include "board.h"
+#include "trace.h"
 
 
 /**
@@ -27,16 +28,47 @@ enum class LogLevel {
     EVERYTHING = 5
 };
 
+#ifndef FANORONA_LOG_LEVEL
+#define FANORONA_LOG_LEVEL 5
+#endif
+
+/**
+ * @brief Most verbose level compiled into the binary
+ *
+ * Set with the FANORONA_LOG_LEVEL CMake option. Log calls above it are
+ * discarded at compile time (see log_compiled), together with the work done
+ * to compute their arguments; a build with 0 has no logging in the search.
+ */
+inline constexpr LogLevel max_compiled_log_level = static_cast<LogLevel>(FANORONA_LOG_LEVEL);
+
+/**
+ * @brief Checks whether messages of a level are compiled in
+ *
+ * Call sites in hot loops wrap their log calls in
+ * `if constexpr (log_compiled(level))`.
+ *
+ * @param level Level of the message
+ * @return true if the level does not exceed max_compiled_log_level
+ */
+constexpr bool log_compiled(LogLevel level) {
+    return static_cast<int>(level) <= static_cast<int>(max_compiled_log_level);
+}
+
 /**
  * @brief Thread-safe singleton logger for MCTS debugging and analysis
  * 
  * Provides hierarchical logging capabilities for different stages of MCTS
  * including selection, expansion, simulation and backpropagation.
+ *
+ * Messages are printed to std::cout as they come, or, once start_trace has
+ * been called, recorded as binary TraceEvents without locking or formatting.
+ * The fanorona_trace tool prints a trace in the same text format.
  */
 class Logger {
 private:
     LogLevel log_level;
     std::mutex mutex;
+    std::unique_ptr<TraceWriter> trace;
     static std::shared_ptr<Logger> logger;
 
     /**
@@ -44,7 +76,7 @@ private:
      * 
      * @param level logging level
      */
-    Logger(LogLevel level) : log_level(level) {}
+    Logger(LogLevel level) : log_level(log_compiled(level) ? level : max_compiled_log_level) {}
 
     /**
      * @brief Internal logging method with thread safety
@@ -61,6 +93,18 @@ private:
      */
     bool should_log(LogLevel required_level) const;
 
+    /**
+     * @brief Creates an event of a type with its move, other fields zeroed
+     */
+    static TraceEvent make_event(TraceEventType type, const std::array<int, 4>& move = {-1, -1, -1, -1});
+
+    /**
+     * @brief Records an event in the trace, or prints it if no trace is open
+     *
+     * @param event The event to log
+     */
+    void emit(const TraceEvent& event);
+
 public:
     /**
      * @brief Get or create the Logger instance
@@ -73,9 +117,11 @@ public:
     /**
      * @brief Set the current logging level
      * 
-     * @param level Logging level
+     * @param level Logging level, lowered to max_compiled_log_level
      */
-    void set_log_level(LogLevel level) { log_level = level; }
+    void set_log_level(LogLevel level) {
+        log_level = log_compiled(level) ? level : max_compiled_log_level;
+    }
     
     /**
      * @brief Get the current logging level
@@ -90,7 +136,36 @@ public:
      * @param move Array containing move coordinates [from_x, from_y, to_x, to_y]
      * @return Formatted move string
      */
-    std::string print_move(std::array<int, 4> move);
+    static std::string print_move(std::array<int, 4> move);
+
+    /**
+     * @brief Format an event as the message printed when no trace is open
+     *
+     * @param event Event read from a trace
+     * @return Message text, without the trailing newline
+     */
+    static std::string format_event(const TraceEvent& event);
+
+    /**
+     * @brief Record the following messages to a binary trace file instead of printing them
+     *
+     * Must not be called while a search is running. A trace already open is closed first.
+     *
+     * @param path File to create
+     */
+    void start_trace(const std::string& path);
+
+    /**
+     * @brief Write the pending events, close the trace file and print messages again
+     *
+     * Must not be called while a search is running.
+     */
+    void stop_trace() { trace.reset(); }
+
+    /**
+     * @brief Check whether messages go to a trace file
+     */
+    bool tracing() const { return trace != nullptr; }
 
     // ========== MCTS Lifecycle Logging (Level 1 - STEPS_ONLY) ==========
     
@@ -231,6 +306,14 @@ public:
     void log_child_node_stats(const std::array<int, 4>& move,
                               float acc_value, int visit_count, 
                               float prior_proba);
+
+    /**
+     * @brief Log the hit rate of the evaluation cache
+     * 
+     * @param hits Lookups answered from the cache
+     * @param lookups Total lookups
+     */
+    void log_cache_stats(size_t hits, size_t lookups);
     
     // ========== Final Decision Logging (Level 1 - STEPS_ONLY and above) ==========
     
@@ -1,11 +1,14 @@
 ﻿#include <torch/torch.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <fstream>
+#include <functional>
 #include <limits>
 #include <memory>
-#include <mutex>
 #include <random>
 #include <sstream>
 #include <thread>
@@ -13,45 +16,338 @@
 #include "mcts_agent.h"
 #include "nn_model.h"
 #include "logger.h"
+#include "puct_kernel.h"
+#include "eval_scheduler.h"
+#include "tree_dump.h"
+#include "thread_config.h"
 
 
-NeuralN::NeuralN(const std::string& model_path, torch::Device device_) : device(device_) {
+namespace {
+
+// Generations of every network and inference mode, never reused (see NeuralN::generation)
+std::atomic<std::uint64_t> next_generation{1};
+
+}  // namespace
+
+NeuralN::NeuralN(const std::string& model_path, torch::Device device_, std::size_t max_batch)
+    : device(device_),
+      generation_id(next_generation.fetch_add(1, std::memory_order_relaxed)),
+      max_batch(std::max<std::size_t>(1, max_batch)) {
     try {
         model = AlphaZeroNetWithMaskImpl::load_model(model_path);
         model->to(device);
         model->eval();
+        inference_net = std::make_unique<FusedAlphaZeroNet>(*model, device);
     } catch (const c10::Error& e) {
         throw;
     }
 }
 
+BufferLease::~BufferLease() {
+    if (leased) {
+        network->release(*leased);
+    }
+}
+
+BufferLease NeuralN::buffers(std::size_t batch) {
+    InferenceBuffers* leased = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        if (!free_buffers.empty()) {
+            leased = free_buffers.back();
+            free_buffers.pop_back();
+        } else {
+            buffer_pool.push_back(std::make_unique<InferenceBuffers>());
+            leased = buffer_pool.back().get();
+        }
+    }
+    if (leased->capacity() == 0 || leased->capacity() < batch) {
+        allocate(*leased, std::max(batch, max_batch));
+    }
+    return BufferLease(*this, *leased);
+}
+
+void NeuralN::release(InferenceBuffers& buffers) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    free_buffers.push_back(&buffers);
+}
+
+void NeuralN::allocate(InferenceBuffers& buffers, std::size_t rows) const {
+    const bool on_device = device.type() != torch::kCPU;
+    const auto host = torch::TensorOptions().dtype(torch::kFloat32).pinned_memory(on_device);
+    const int64_t count = static_cast<int64_t>(rows);
+    buffers.input_tensor = torch::empty({count, 11, 5, 9}, host);
+    buffers.mask_tensor = torch::empty({count, Board::policy_size}, host);
+    buffers.policy_tensor = torch::empty({count, Board::policy_size}, host);
+    buffers.value_tensor = torch::empty({count}, host);
+    if (on_device) {
+        const auto on_network = torch::TensorOptions().dtype(torch::kFloat32).device(device);
+        buffers.device_input = torch::empty({count, 11, 5, 9}, on_network);
+        buffers.device_mask = torch::empty({count, Board::policy_size}, on_network);
+    }
+    buffers.input_data = buffers.input_tensor.data_ptr<float>();
+    buffers.mask_data = buffers.mask_tensor.data_ptr<float>();
+    buffers.policy_data = buffers.policy_tensor.data_ptr<float>();
+    buffers.value_data = buffers.value_tensor.data_ptr<float>();
+    buffers.rows = rows;
+}
+
+void NeuralN::evaluate(InferenceBuffers& buffers, std::size_t batch) {
+    c10::InferenceMode inference_mode;
+    if (cpu_engine) {
+        cpu_engine->evaluate(buffers.input_data, buffers.mask_data, static_cast<int>(batch), buffers.policy_data,
+                             buffers.value_data);
+        return;
+    }
+
+    const int64_t rows = static_cast<int64_t>(batch);
+    torch::Tensor input = buffers.input_tensor.narrow(0, 0, rows);
+    torch::Tensor legal_mask = buffers.mask_tensor.narrow(0, 0, rows);
+    if (buffers.device_input.defined()) {
+        // Page-locked host rows: the uploads do not block the host
+        input = buffers.device_input.narrow(0, 0, rows).copy_(input, true);
+        legal_mask = buffers.device_mask.narrow(0, 0, rows).copy_(legal_mask, true);
+    }
+    auto [policy, value] = inference_net->forward(input, legal_mask);
+    buffers.policy_tensor.narrow(0, 0, rows).copy_(policy);
+    buffers.value_tensor.narrow(0, 0, rows).copy_(value);
+}
+
 std::pair<torch::Tensor, torch::Tensor> NeuralN::predict(torch::Tensor input, torch::Tensor legal_mask) {
-    torch::NoGradGuard no_grad;
+    c10::InferenceMode inference_mode;
+    if (cpu_engine) {
+        input = input.to(torch::kFloat32).contiguous();
+        if (legal_mask.defined()) legal_mask = legal_mask.to(torch::kFloat32).contiguous();
+        const int64_t batch = input.size(0);
+        torch::Tensor policy = torch::empty({batch, cpu_engine->num_moves()}, torch::kFloat32);
+        torch::Tensor value = torch::empty({batch}, torch::kFloat32);
+        cpu_engine->evaluate(input.data_ptr<float>(), legal_mask.defined() ? legal_mask.data_ptr<float>() : nullptr,
+                             static_cast<int>(batch), policy.data_ptr<float>(), value.data_ptr<float>());
+        return {policy, value};
+    }
     input = input.to(device);
     if (legal_mask.defined()) legal_mask = legal_mask.to(device);
-    return model->forward(input, legal_mask);
+    return inference_net->forward(input, legal_mask);
+}
+
+void NeuralN::enable_cpu_engine() {
+    if (device.type() != torch::kCPU) {
+        throw std::runtime_error("The built-in inference engine runs on the CPU only");
+    }
+    cpu_engine = std::make_unique<CpuInferenceEngine>(inference_net->export_weights());
+    generation_id = next_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NeuralN::disable_cpu_engine() {
+    cpu_engine.reset();
+    generation_id = next_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NeuralN::disable_int8() {
+    inference_net->disable_int8();
+    generation_id = next_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+QuantizationReport NeuralN::enable_int8(const GameDataset& positions, double max_policy_kl,
+                                        std::size_t max_positions) {
+    const std::size_t count = std::min(positions.current_size, max_positions);
+    if (count == 0) {
+        throw std::runtime_error("INT8 calibration needs stored positions");
+    }
+    std::vector<torch::Tensor> inputs(positions.boards.begin(), positions.boards.begin() + count);
+    std::vector<torch::Tensor> legal_masks(positions.legal_mask.begin(), positions.legal_mask.begin() + count);
+    QuantizationReport report = inference_net->calibrate_int8(torch::stack(inputs).to(device),
+                                                              torch::stack(legal_masks).to(device), max_policy_kl);
+    generation_id = next_generation.fetch_add(1, std::memory_order_relaxed);
+    return report;
 }
 
-Mcts_agent::Mcts_agent(double exploration_factor, int number_iteration, LogLevel log_level)
-    : exploration_factor(exploration_factor),
+Mcts_agent::Mcts_agent(double exploration_factor, int number_iteration, LogLevel log_level, int num_threads,
+                       bool ponder, ParallelMode parallel_mode, std::size_t max_tree_bytes,
+                       TreeMemoryPolicy memory_policy)
+    : Mcts_agent(std::make_shared<NeuralN>("checkpoint/1.pt"), exploration_factor, number_iteration, log_level,
+                 num_threads, ponder, parallel_mode, max_tree_bytes, memory_policy) {}
+
+Mcts_agent::Mcts_agent(std::shared_ptr<NeuralN> network, double exploration_factor, int number_iteration,
+                       LogLevel log_level, int num_threads, bool ponder, ParallelMode parallel_mode,
+                       std::size_t max_tree_bytes, TreeMemoryPolicy memory_policy)
+    : agent(std::move(network)),
+      exploration_factor(exploration_factor),
       number_iteration(number_iteration),
+      num_threads(std::max(1, num_threads)),
+      virtual_loss(num_threads > 1 && parallel_mode == ParallelMode::Tree ? 1 : 0),
+      log_level(log_level),
       logger(Logger::instance(log_level)),
-      random_generator(random_device()) {
-    agent = std::make_shared<NeuralN>("checkpoint/1.pt");
-}
-
-Mcts_agent::Node::Node(Cell_state player, std::array<int, 4> move, float prior_proba, float value_from_nn,
-                       std::shared_ptr<Node> parent_node)
-    : value_from_nn(value_from_nn),
-      value_from_mcts(0.0f),
-      expanded(false),
-      acc_value(0.0f),
-      prior_proba(prior_proba),
-      visit_count(0),
-      move(move),
-      player(player),
-      child_nodes(),
-      parent_node(parent_node) {}
+      eval_cache(EvalCache::instance()),
+      random_generator(make_random_stream()),
+      ponder(ponder && parallel_mode == ParallelMode::Tree),
+      parallel_mode(num_threads > 1 ? parallel_mode : ParallelMode::Tree),
+      max_tree_bytes(max_tree_bytes),
+      memory_policy(memory_policy),
+      tree(node_capacity()),
+      edges(tree.capacity() * edges_per_iteration),
+      root(kNullNode),
+      transpositions(tree.capacity()),
+      spare_tree(this->ponder || memory_policy == TreeMemoryPolicy::Recycle ? tree.capacity() : 0),
+      spare_edges(this->ponder || memory_policy == TreeMemoryPolicy::Recycle ? edges.capacity() : 0),
+      stop_requested(false),
+      gumbel_choice(kNullEdge) {
+    if (this->parallel_mode == ParallelMode::Root) {
+        const int member_iterations = (number_iteration + this->num_threads - 1) / this->num_threads;
+        for (int i = 0; i < this->num_threads; ++i) {
+            ensemble.push_back(std::unique_ptr<Mcts_agent>(
+                new Mcts_agent(agent, exploration_factor, member_iterations, log_level, 1, false, ParallelMode::Tree,
+                               max_tree_bytes / this->num_threads, memory_policy)));
+        }
+    }
+}
+
+namespace {
+
+std::int64_t nanoseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Final move rule: whether a visited root child beats the best one so far
+ *
+ * By mean value, or by visits (mean value on ties) when the search may stop
+ * early, since the early stop only guarantees that the most visited child
+ * keeps its lead. Proven results (infinite means) always rank by mean:
+ * a proven win is taken and a proven loss only when nothing else is left.
+ */
+bool better_move(std::int32_t visits, double mean, std::int32_t best_visits, double best_mean, bool by_visits) {
+    if (!by_visits || std::isinf(mean) || std::isinf(best_mean)) {
+        return mean > best_mean;
+    }
+    return visits > best_visits || (visits == best_visits && mean > best_mean);
+}
+
+}  // namespace
+
+Mcts_agent::~Mcts_agent() {
+    stop_pondering();
+}
+
+std::size_t Mcts_agent::node_capacity() const {
+    // In root-parallel mode the trees belong to the ensemble members
+    if (parallel_mode == ParallelMode::Root) {
+        return 0;
+    }
+    const std::size_t min_nodes = static_cast<std::size_t>(num_threads) + 2;
+    if (max_tree_bytes > 0) {
+        const std::size_t copies = ponder || memory_policy == TreeMemoryPolicy::Recycle ? 2 : 1;
+        const std::size_t bytes_per_node = copies * (sizeof(Node) + edges_per_iteration * EdgeArena::bytes_per_edge) +
+                                           TranspositionTable::bytes_per_node();
+        return std::max(min_nodes, max_tree_bytes / bytes_per_node);
+    }
+    // A kept tree may take up to number_iteration nodes before the next search adds its own
+    return static_cast<std::size_t>(number_iteration) * (ponder ? 2 : 1) + min_nodes - 1;
+}
+
+void Mcts_agent::reserve_tree(const SearchBudget& budget) {
+    // A byte cap fixes the arenas: the memory policy decides what happens when they fill
+    if (max_tree_bytes > 0 || parallel_mode == ParallelMode::Root) {
+        return;
+    }
+
+    std::size_t planned = static_cast<std::size_t>(number_iteration);
+    if (budget.max_iterations > 0) {
+        planned = static_cast<std::size_t>(budget.max_iterations);
+    } else if (budget.max_time.count() > 0 && last_stats.simulations_per_second > 0.0) {
+        const double seconds = std::chrono::duration<double>(budget.max_time).count();
+        planned = std::max(planned, static_cast<std::size_t>(1.25 * last_stats.simulations_per_second * seconds));
+    } else if (budget.max_nodes > 0) {
+        planned = budget.max_nodes;
+    }
+    const std::size_t slack = static_cast<std::size_t>(num_threads) + 2;
+    std::size_t needed = tree.size() + planned + slack;
+    if (budget.max_nodes > 0) {
+        needed = std::min(needed, budget.max_nodes + slack);
+    }
+    if (needed <= tree.capacity()) {
+        return;
+    }
+
+    // Grow geometrically, so that budgets creeping up do not reallocate every search
+    const std::size_t capacity =
+        std::min(std::max(needed, 2 * tree.capacity()), static_cast<std::size_t>(kNullNode) - 1);
+    NodeArena<Node> larger_tree(capacity);
+    EdgeArena larger_edges(capacity * edges_per_iteration);
+    TranspositionTable larger_table(capacity);
+    transpositions.swap(larger_table);
+    if (root != kNullNode && tree.size() > 0) {
+        // Copy the kept tree: compact_tree builds into the spare arenas, then swaps them in
+        spare_tree.swap(larger_tree);
+        spare_edges.swap(larger_edges);
+        compact_tree(root);
+    } else {
+        tree.swap(larger_tree);
+        edges.swap(larger_edges);
+    }
+
+    // Pondering and recycling compact into spare arenas of the same size
+    const bool needs_spares = ponder || memory_policy == TreeMemoryPolicy::Recycle;
+    NodeArena<Node> new_spare_tree(needs_spares ? capacity : 0);
+    EdgeArena new_spare_edges(needs_spares ? edges.capacity() : 0);
+    spare_tree.swap(new_spare_tree);
+    spare_edges.swap(new_spare_edges);
+}
+
+void Mcts_agent::Node::reset(Cell_state player_, std::uint64_t key_, float value_from_nn_, NodeIndex parent_node_,
+                             EdgeIndex parent_edge_) {
+    key = key_;
+    value_from_nn = value_from_nn_;
+    expansion_state.store(ExpansionState::Unexpanded, std::memory_order_relaxed);
+    proof.store(Proof::Unknown, std::memory_order_relaxed);
+    visit_count.store(0, std::memory_order_relaxed);
+    player = player_;
+    first_edge = kNullEdge;
+    num_edges = 0;
+    parent_node = parent_node_;
+    parent_edge = parent_edge_;
+}
+
+std::array<int, 4> Mcts_agent::node_move(NodeIndex node) const {
+    EdgeIndex parent_edge = tree[node].parent_edge;
+    if (parent_edge == kNullEdge) {
+        return {-1, -1, -1, -1};
+    }
+    return edge_move(parent_edge);
+}
+
+std::array<int, 4> Mcts_agent::edge_move(EdgeIndex edge) const {
+    return Board::index_to_move(edges.move_index(edge));
+}
+
+NodeIndex Mcts_agent::materialize_child(NodeIndex parent_node, EdgeIndex edge, std::uint64_t child_key) {
+    NodeIndex child = edges.child(edge);
+    if (child != kNullNode) {
+        return child;
+    }
+
+    // Transposition: the position was already reached by another move order
+    NodeIndex transposed = transpositions.find(child_key);
+    if (transposed != kNullNode) {
+        return edges.set_child(edge, transposed);
+    }
+
+    NodeIndex new_child = tree.allocate(1);
+    if (new_child == kNullNode) {
+        return kNullNode;
+    }
+
+    // The same player keeps the turn after a capture, otherwise it passes
+    Cell_state parent_player = tree[parent_node].player;
+    Cell_state child_player = parent_player;
+    if (edge_move(edge)[3] < 1) {
+        child_player = (parent_player == Cell_state::X ? Cell_state::O : Cell_state::X);
+    }
+    tree[new_child].reset(child_player, child_key, 0.0, parent_node, edge);
+
+    // If another thread inserted the same position meanwhile, use its node (ours stays unused)
+    return edges.set_child(edge, transpositions.insert(child_key, new_child));
+}
 
 std::vector<float> Mcts_agent::generate_dirichlet_noise(int num_moves, float alpha) {
     if (num_moves == 0) return {};
@@ -74,38 +370,822 @@ std::vector<float> Mcts_agent::generate_dirichlet_noise(int num_moves, float alp
 }
 
 std::pair<std::array<int, 4>, torch::Tensor> Mcts_agent::choose_move(const Board& board, Cell_state player) {
-    //   auto start = std::chrono::high_resolution_clock::now();
+    SearchBudget budget;
+    budget.max_iterations = number_iteration;
+    budget.early_stop = false;
+    return choose_move(board, player, budget);
+}
+
+std::pair<std::array<int, 4>, torch::Tensor> Mcts_agent::choose_move(const Board& board, Cell_state player,
+                                                                     const SearchBudget& budget) {
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_mcts_start(player);
+    }
+    if (parallel_mode == ParallelMode::Root) {
+        return choose_move_root_parallel(board, player, budget);
+    }
+
+    int mcts_iteration_counter = search(board, player, budget);
+
+    const Node& root_node = tree[root];
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_timer_ran_out(mcts_iteration_counter);
+    }
+    if constexpr (log_compiled(LogLevel::ROOT_STATS)) {
+        logger->log_cache_stats(eval_cache->hits(), eval_cache->lookups());
+        logger->log_root_stats(root_node.visit_count, root_node.num_edges);
+    }
+
+    EdgeIndex best_child = gumbel_choice != kNullEdge ? gumbel_choice : select_best_child(root, budget.early_stop);
+
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_best_child_chosen(mcts_iteration_counter, edge_move(best_child), edges.mean_value(best_child),
+                                      edges.visit_count(best_child));
+        logger->log_mcts_end();
+    }
+
+    if constexpr (log_compiled(LogLevel::ROOT_STATS)) {
+        for (EdgeIndex edge = root_node.first_edge; edge < root_node.first_edge + root_node.num_edges; ++edge) {
+            logger->log_child_node_stats(edge_move(edge), edges.value_sum(edge),
+                                         edges.visit_count(edge), edges.prior(edge));
+        }
+    }
+
+    torch::Tensor policy_from_mcts = gumbel_choice != kNullEdge ? get_improved_policy() : get_policy_logits(root);
+    std::array<int, 4> best_move = edge_move(best_child);
+
+    if (!tree_export_path.empty()) {
+        export_tree(tree_export_path);
+    }
+
+    if (ponder) {
+        start_pondering(board, best_child);
+    }
+
+    return {best_move, policy_from_mcts};
+}
+
+void Mcts_agent::SearchCounters::reset() {
+    nn_evaluations.store(0, std::memory_order_relaxed);
+    batch_rows.store(0, std::memory_order_relaxed);
+    batch_slots.store(0, std::memory_order_relaxed);
+    cache_hits.store(0, std::memory_order_relaxed);
+    depth_sum.store(0, std::memory_order_relaxed);
+    max_depth.store(0, std::memory_order_relaxed);
+    selection_ns.store(0, std::memory_order_relaxed);
+    expansion_ns.store(0, std::memory_order_relaxed);
+    nn_ns.store(0, std::memory_order_relaxed);
+    backup_ns.store(0, std::memory_order_relaxed);
+    recycled_nodes.store(0, std::memory_order_relaxed);
+    arena_full.store(0, std::memory_order_relaxed);
+}
+
+void Mcts_agent::finish_search_stats(int simulations, std::chrono::steady_clock::time_point start) {
+    SearchStats stats;
+    stats.simulations = simulations;
+    stats.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.simulations_per_second = stats.elapsed_seconds > 0.0 ? simulations / stats.elapsed_seconds : 0.0;
+    stats.nn_evaluations = counters.nn_evaluations.load(std::memory_order_relaxed);
+    stats.cache_hits = counters.cache_hits.load(std::memory_order_relaxed);
+    stats.average_depth =
+        simulations > 0 ? static_cast<double>(counters.depth_sum.load(std::memory_order_relaxed)) / simulations : 0.0;
+    stats.max_depth = counters.max_depth.load(std::memory_order_relaxed);
+    stats.node_count = tree.size();
+    stats.tree_bytes = tree.bytes_used() + edges.bytes_used();
+    stats.selection_seconds = counters.selection_ns.load(std::memory_order_relaxed) * 1e-9;
+    stats.expansion_seconds = counters.expansion_ns.load(std::memory_order_relaxed) * 1e-9;
+    stats.nn_seconds = counters.nn_ns.load(std::memory_order_relaxed) * 1e-9;
+    stats.backup_seconds = counters.backup_ns.load(std::memory_order_relaxed) * 1e-9;
+    stats.recycled_nodes = counters.recycled_nodes.load(std::memory_order_relaxed);
+    stats.arena_full = counters.arena_full.load(std::memory_order_relaxed);
+    std::uint64_t slots = counters.batch_slots.load(std::memory_order_relaxed);
+    stats.batch_fill_ratio =
+        slots > 0 ? static_cast<double>(counters.batch_rows.load(std::memory_order_relaxed)) / slots : 0.0;
+    last_stats = stats;
+}
+
+int Mcts_agent::search(const Board& board, Cell_state player, const SearchBudget& budget) {
+    stop_pondering();
+    const auto start = std::chrono::steady_clock::now();
+    counters.reset();
+    gumbel_choice = kNullEdge;
+    // The Gumbel root explores through its own sampling, without Dirichlet noise
+    const bool use_gumbel = budget.gumbel_root && budget.max_iterations > 0;
+    const bool root_noise = budget.root_noise && !use_gumbel;
+
+    NodeIndex reusable_root = ponder ? find_reusable_root(board, player) : kNullNode;
+    if (reusable_root != kNullNode) {
+        // The position was reached in the pondered tree: keep its subtree
+        compact_tree(reusable_root);
+        if (root_noise) {
+            apply_dirichlet_noise(root, 0.5f, 0.3f);
+        }
+    } else {
+        // Release the previous tree in bulk, then create a new root node and expand it
+        tree.clear();
+        edges.clear();
+        transpositions.clear();
+        root = tree.allocate(1);
+        tree[root].reset(player, board.hash(player), 0.0, kNullNode, kNullEdge);
+        transpositions.insert(tree[root].key, root);
+
+        // Initialize root with Dirichlet noise for exploration
+        tree[root].expansion_state.store(ExpansionState::Expanding, std::memory_order_relaxed);
+        initiate_and_run_nn(root, board, root_noise, 0.5f, 0.3f);
+    }
+    root_board.reset();
+    reserve_tree(budget);
+
+    int mcts_iteration_counter = 0;
+    if (use_gumbel) {
+        mcts_iteration_counter = run_gumbel_root(budget, board);
+    } else {
+        // Run MCTS until the budget runs out
+        perform_mcts_iterations(budget, mcts_iteration_counter, board);
+    }
+
+    finish_search_stats(mcts_iteration_counter, start);
+    return mcts_iteration_counter;
+}
+
+void Mcts_agent::start_search(const Board& board, Cell_state player, const SearchBudget& budget) {
+    stop_pondering();
+    counters.reset();
+    gumbel_choice = kNullEdge;
+    root_board.reset();
+    stepwise.emplace(budget, std::chrono::steady_clock::now(), 0, budget.root_noise, board);
+
+    // The root is expanded by the first evaluation handed out by advance_search
+    tree.clear();
+    edges.clear();
+    transpositions.clear();
+    reserve_tree(budget);
+    root = tree.allocate(1);
+    tree[root].reset(player, board.hash(player), 0.0, kNullNode, kNullEdge);
+    transpositions.insert(tree[root].key, root);
+}
+
+bool Mcts_agent::advance_search(EvaluationRequest& request) {
+    StepwiseSearch& step = *stepwise;
+    float value;
+    std::vector<std::pair<std::uint16_t, float>> move_with_logit;
+
+    if (tree[root].expansion_state.load(std::memory_order_relaxed) == ExpansionState::Unexpanded) {
+        tree[root].expansion_state.store(ExpansionState::Expanding, std::memory_order_relaxed);
+        step.leaf = root;
+        step.leaf_key = tree[root].key;
+        step.path.clear();
+        if (!lookup_evaluation(step.leaf_key, value, move_with_logit)) {
+            request.fill(step.board, tree[root].player);
+            return true;
+        }
+        expand_node(root, value, move_with_logit, step.root_noise, 0.5f, 0.3f);
+    }
+
+    while (!should_stop_search(step.budget, step.completed, step.start)) {
+        step.path.clear();
+        auto phase_start = std::chrono::steady_clock::now();
+        auto [leaf, leaf_board] = select_child_for_playout(root, step.board, step.path);
+        counters.selection_ns.fetch_add(nanoseconds_since(phase_start), std::memory_order_relaxed);
+        record_depth(static_cast<int>(step.path.size()));
+
+        bool repeated = std::any_of(step.path.begin(), step.path.end(),
+                                    [&](const auto& path_step) { return path_step.first == leaf; });
+        Node& leaf_node = tree[leaf];
+        if (!repeated && leaf_node.proof.load(std::memory_order_relaxed) == Proof::Unknown &&
+            leaf_node.expansion_state.load(std::memory_order_relaxed) == ExpansionState::Unexpanded &&
+            leaf_board.check_winner() == Cell_state::Empty) {
+            // A new position: hand it to the caller unless the cache knows it
+            leaf_node.expansion_state.store(ExpansionState::Expanding, std::memory_order_relaxed);
+            step.leaf = leaf;
+            step.leaf_key = leaf_node.key;
+            move_with_logit.clear();
+            if (!lookup_evaluation(step.leaf_key, value, move_with_logit)) {
+                request.fill(leaf_board, leaf_node.player);
+                return true;
+            }
+            expand_node(leaf, value, move_with_logit, false, 0.0f, 0.0f);
+        } else {
+            // Terminal, proven, repeated, or childless because the arenas are full
+            value = repeated ? 0.0f : simulate_random_playout(leaf, leaf_board);
+        }
+
+        phase_start = std::chrono::steady_clock::now();
+        backpropagate(step.path, value);
+        propagate_proof(step.path);
+        counters.backup_ns.fetch_add(nanoseconds_since(phase_start), std::memory_order_relaxed);
+        ++step.completed;
+    }
+    return false;
+}
+
+void Mcts_agent::provide_evaluation(std::span<const float> policy, float value, std::size_t batch_size,
+                                    std::size_t batch_capacity) {
+    StepwiseSearch& step = *stepwise;
+    record_evaluation(batch_size, batch_capacity);
+
+    std::vector<std::pair<std::uint16_t, float>> move_with_logit = sparse_policy(policy);
+    eval_cache->store(step.leaf_key, agent->generation(), value, move_with_logit);
+
+    // An empty path means the root itself was evaluated: no simulation to back up
+    const bool is_root = step.path.empty();
+    expand_node(step.leaf, value, move_with_logit, is_root && step.root_noise, 0.5f, 0.3f);
+    if (!is_root) {
+        const auto backup_start = std::chrono::steady_clock::now();
+        backpropagate(step.path, value);
+        propagate_proof(step.path);
+        counters.backup_ns.fetch_add(nanoseconds_since(backup_start), std::memory_order_relaxed);
+        ++step.completed;
+    }
+    step.leaf = kNullNode;
+}
+
+std::pair<std::array<int, 4>, torch::Tensor> Mcts_agent::finish_search() {
+    finish_search_stats(stepwise->completed.load(), stepwise->start);
+    if (stepwise->restore_virtual_loss >= 0) {
+        virtual_loss = stepwise->restore_virtual_loss;
+    }
+    const bool by_visits = stepwise->budget.early_stop;
+    stepwise.reset();
+
+    EdgeIndex best_child = select_best_child(root, by_visits);
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_best_child_chosen(last_stats.simulations, edge_move(best_child), edges.mean_value(best_child),
+                                      edges.visit_count(best_child));
+    }
+    return {edge_move(best_child), get_policy_logits(root)};
+}
+
+void Mcts_agent::spawn_search(EvalScheduler& scheduler, const Board& board, Cell_state player,
+                              const SearchBudget& budget, int in_flight) {
+    start_search(board, player, budget);
+    // Simulations of this tree are in flight together, like search threads
+    stepwise->restore_virtual_loss = virtual_loss;
+    virtual_loss = 1;
+    scheduler.spawn(expand_root_task(scheduler, std::max(1, in_flight)));
+}
+
+SearchTask Mcts_agent::expand_root_task(EvalScheduler& scheduler, int in_flight) {
+    StepwiseSearch& step = *stepwise;
+    const Cell_state player = tree[root].player;
+    tree[root].expansion_state.store(ExpansionState::Expanding, std::memory_order_relaxed);
+
+    float value;
+    std::vector<std::pair<std::uint16_t, float>> move_with_logit;
+    if (!lookup_evaluation(tree[root].key, value, move_with_logit)) {
+        auto [priors, nn_value, batch_size] = co_await scheduler.evaluate(step.board, player);
+        record_evaluation(batch_size, scheduler.batch_capacity());
+        value = nn_value;
+        move_with_logit = std::move(priors);
+        eval_cache->store(tree[root].key, agent->generation(), value, move_with_logit);
+    }
+    expand_node(root, value, move_with_logit, step.root_noise, 0.5f, 0.3f);
+
+    for (int i = 0; i < in_flight; ++i) {
+        scheduler.spawn(simulation_task(scheduler));
+    }
+}
+
+SearchTask Mcts_agent::simulation_task(EvalScheduler& scheduler) {
+    StepwiseSearch& step = *stepwise;
+    std::vector<std::pair<NodeIndex, EdgeIndex>> path;
+    std::vector<std::pair<std::uint16_t, float>> move_with_logit;
+    const int max_iterations =
+        step.budget.max_iterations > 0 ? step.budget.max_iterations : std::numeric_limits<int>::max();
+    // Each simulation takes a ticket first, so the simulations in flight never overrun the budget
+    while (!scheduler.failed() &&
+           !should_stop_search(step.budget, step.completed.load(std::memory_order_relaxed), step.start) &&
+           step.next_iteration.fetch_add(1, std::memory_order_relaxed) < max_iterations) {
+        path.clear();
+        auto phase_start = std::chrono::steady_clock::now();
+        auto [leaf, leaf_board] = select_child_for_playout(root, step.board, path);
+        counters.selection_ns.fetch_add(nanoseconds_since(phase_start), std::memory_order_relaxed);
+        record_depth(static_cast<int>(path.size()));
+
+        bool repeated = std::any_of(path.begin(), path.end(),
+                                    [&](const auto& path_step) { return path_step.first == leaf; });
+        float value;
+        if (repeated) {
+            value = 0.0f;
+        } else if (tree[leaf].proof.load(std::memory_order_relaxed) == Proof::Unknown &&
+                   leaf_board.check_winner() == Cell_state::Empty) {
+            ExpansionState expected = ExpansionState::Unexpanded;
+            if (tree[leaf].expansion_state.compare_exchange_strong(expected, ExpansionState::Expanding,
+                                                                   std::memory_order_acq_rel)) {
+                const std::uint64_t leaf_key = tree[leaf].key;
+                const Cell_state leaf_player = tree[leaf].player;
+                move_with_logit.clear();
+                if (!lookup_evaluation(leaf_key, value, move_with_logit)) {
+                    EvalScheduler::EvaluationResult result{};
+                    try {
+                        result = co_await scheduler.evaluate(leaf_board, leaf_player);
+                    } catch (...) {
+                        // The leaf is never expanded: release it so that no simulation waits for it
+                        tree[leaf].expansion_state.store(ExpansionState::Unexpanded, std::memory_order_release);
+                        throw;
+                    }
+                    record_evaluation(result.batch_size, scheduler.batch_capacity());
+                    value = result.value;
+                    move_with_logit = std::move(result.priors);
+                    eval_cache->store(leaf_key, agent->generation(), value, move_with_logit);
+                }
+                expand_node(leaf, value, move_with_logit, false, 0.0f, 0.0f);
+            } else {
+                // Another simulation is evaluating this leaf: wait for its batch without blocking the thread
+                while (!tree[leaf].expanded()) {
+                    if (scheduler.failed()) {
+                        co_return;  // The evaluation may have failed: the search is over
+                    }
+                    co_await scheduler.next_batch();
+                }
+                value = tree[leaf].value_from_nn;
+            }
+        } else {
+            // Proven or terminal: no network needed
+            value = simulate_random_playout(leaf, leaf_board);
+        }
+
+        phase_start = std::chrono::steady_clock::now();
+        backpropagate(path, value);
+        propagate_proof(path);
+        counters.backup_ns.fetch_add(nanoseconds_since(phase_start), std::memory_order_relaxed);
+        step.completed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::pair<std::array<int, 4>, torch::Tensor> Mcts_agent::choose_move_root_parallel(const Board& board,
+                                                                                   Cell_state player,
+                                                                                   const SearchBudget& budget) {
+    // Split the work limits between the members, the time limit applies to each of them
+    const int members = static_cast<int>(ensemble.size());
+    SearchBudget member_budget = budget;
+    if (budget.max_iterations > 0) {
+        member_budget.max_iterations = (budget.max_iterations + members - 1) / members;
+    }
+    if (budget.max_nodes > 0) {
+        member_budget.max_nodes = (budget.max_nodes + members - 1) / members;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<int> member_iterations(members, 0);
+    std::vector<std::thread> workers;
+    workers.reserve(members);
+    for (int i = 0; i < members; ++i) {
+        workers.emplace_back([&, i]() {
+            pin_search_thread(i);
+            member_iterations[i] = ensemble[i]->search(board, player, member_budget);
+        });
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (!tree_export_path.empty()) {
+        ensemble.front()->export_tree(tree_export_path);
+    }
+
+    // Merge the root children move by move; the edge values share the root player's perspective
+    std::vector<std::int32_t> merged_visits(Board::policy_size, 0);
+    std::vector<float> merged_value_sums(Board::policy_size, 0.0f);
+    std::int32_t total_visits = 0;
+    int mcts_iteration_counter = 0;
+    for (int i = 0; i < members; ++i) {
+        const Mcts_agent& member = *ensemble[i];
+        const Node& member_root = member.tree[member.root];
+        for (EdgeIndex edge = member_root.first_edge; edge < member_root.first_edge + member_root.num_edges; ++edge) {
+            std::uint16_t move_index = member.edges.move_index(edge);
+            merged_visits[move_index] += member.edges.visit_count(edge);
+            merged_value_sums[move_index] += member.edges.value_sum(edge);
+        }
+        total_visits += member_root.visit_count.load(std::memory_order_relaxed);
+        mcts_iteration_counter += member_iterations[i];
+    }
+
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_timer_ran_out(mcts_iteration_counter);
+    }
+    if constexpr (log_compiled(LogLevel::ROOT_STATS)) {
+        logger->log_cache_stats(eval_cache->hits(), eval_cache->lookups());
+    }
+
+    // Sum the figures of the members; averages are weighted by their simulations
+    SearchStats stats;
+    double depth_sum = 0.0;
+    double fill_sum = 0.0;
+    for (const auto& member : ensemble) {
+        const SearchStats& member_stats = member->last_search_stats();
+        stats.simulations += member_stats.simulations;
+        stats.nn_evaluations += member_stats.nn_evaluations;
+        stats.cache_hits += member_stats.cache_hits;
+        depth_sum += member_stats.average_depth * member_stats.simulations;
+        stats.max_depth = std::max(stats.max_depth, member_stats.max_depth);
+        stats.node_count += member_stats.node_count;
+        stats.tree_bytes += member_stats.tree_bytes;
+        stats.recycled_nodes += member_stats.recycled_nodes;
+        stats.arena_full += member_stats.arena_full;
+        stats.selection_seconds += member_stats.selection_seconds;
+        stats.expansion_seconds += member_stats.expansion_seconds;
+        stats.nn_seconds += member_stats.nn_seconds;
+        stats.backup_seconds += member_stats.backup_seconds;
+        fill_sum += member_stats.batch_fill_ratio * member_stats.nn_evaluations;
+    }
+    stats.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.simulations_per_second = stats.elapsed_seconds > 0.0 ? stats.simulations / stats.elapsed_seconds : 0.0;
+    stats.average_depth = stats.simulations > 0 ? depth_sum / stats.simulations : 0.0;
+    stats.batch_fill_ratio = stats.nn_evaluations > 0 ? fill_sum / stats.nn_evaluations : 0.0;
+    last_stats = stats;
+
+    // Same criterion as select_best_child, on the merged statistics
+    int best_move_index = -1;
+    double max_win_ratio = -1.;
+    int visited_moves = 0;
+    for (int move_index = 0; move_index < Board::policy_size; ++move_index) {
+        if (merged_visits[move_index] == 0) {
+            continue;
+        }
+        visited_moves++;
+        double win_ratio = static_cast<double>(merged_value_sums[move_index]) / merged_visits[move_index];
+        if (best_move_index < 0 || better_move(merged_visits[move_index], win_ratio, merged_visits[best_move_index],
+                                               max_win_ratio, budget.early_stop)) {
+            max_win_ratio = win_ratio;
+            best_move_index = move_index;
+        }
+    }
+    if constexpr (log_compiled(LogLevel::ROOT_STATS)) {
+        logger->log_root_stats(total_visits, visited_moves);
+    }
+    if (best_move_index < 0) {
+        throw std::runtime_error(
+            "Statistics are not enough to determine a move. The AI had insufficient time for the given board size.");
+    }
+
+    std::array<int, 4> best_move = Board::index_to_move(best_move_index);
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_best_child_chosen(mcts_iteration_counter, best_move, static_cast<float>(max_win_ratio),
+                                      merged_visits[best_move_index]);
+        logger->log_mcts_end();
+    }
+
+    torch::Tensor policy_from_mcts = torch::zeros({Board::policy_size}, torch::kFloat32);
+    float* data = policy_from_mcts.data_ptr<float>();
+    for (int move_index = 0; move_index < Board::policy_size; ++move_index) {
+        if (merged_visits[move_index] > 0) {
+            data[move_index] = merged_visits[move_index] / static_cast<float>(total_visits);
+        }
+    }
 
-    logger->log_mcts_start(player);
-    // Create a new  root node and expand it
-    std::array<int, 4> arr = {-1, -1, -1, -1};
-    root = std::make_shared<Node>(player, arr, 0.0, 0.0, nullptr);
+    return {best_move, policy_from_mcts};
+}
 
-    // Initialize root with Dirichlet noise for exploration
-    initiate_and_run_nn(root, board, true, 0.5f, 0.3f);
+int Mcts_agent::run_gumbel_root(const SearchBudget& budget, const Board& board) {
+    // Recycling may move the root node between rounds, but never its edges
+    const EdgeIndex first_edge = tree[root].first_edge;
+    const std::uint32_t num_moves = tree[root].num_edges;
+    if (num_moves == 0) {
+        return 0;
+    }
+
+    // Gumbel-Top-k trick: the k best g(a) + logit(a) are a sample without replacement from the prior
+    std::extreme_value_distribution<float> gumbel(0.0f, 1.0f);
+    std::vector<float> perturbed_logits(num_moves);
+    std::vector<std::uint32_t> candidates(num_moves);
+    for (std::uint32_t i = 0; i < num_moves; ++i) {
+        float logit = std::log(std::max(edges.prior(first_edge + i), 1e-8f));
+        perturbed_logits[i] = gumbel(random_generator) + logit;
+        candidates[i] = i;
+    }
+    const std::size_t k = std::min<std::size_t>(std::max(1, budget.gumbel_actions), num_moves);
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(),
+                      [&](std::uint32_t a, std::uint32_t b) { return perturbed_logits[a] > perturbed_logits[b]; });
+    candidates.resize(k);
+
+    auto max_root_visits = [&]() {
+        std::int32_t max_visits = 0;
+        for (EdgeIndex edge = first_edge; edge < first_edge + num_moves; ++edge) {
+            max_visits = std::max(max_visits, edges.visit_count(edge));
+        }
+        return max_visits;
+    };
+    auto sort_candidates = [&]() {
+        const std::int32_t max_visits = max_root_visits();
+        std::vector<float> score(num_moves);
+        for (std::uint32_t i : candidates) {
+            score[i] = perturbed_logits[i] + gumbel_sigma(first_edge + i, max_visits);
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&](std::uint32_t a, std::uint32_t b) { return score[a] > score[b]; });
+    };
 
+    // Sequential halving: split the simulations evenly over log2(k) rounds
+    const auto start = std::chrono::steady_clock::now();
+    int rounds_left = std::max(1, static_cast<int>(std::ceil(std::log2(static_cast<double>(k)))));
+    SearchBudget round_budget = budget;
+    round_budget.early_stop = false;
     int mcts_iteration_counter = 0;
-    // Run MCTS until the timer runs out
-    perform_mcts_iterations(number_iteration, mcts_iteration_counter, board);
+    auto may_continue = [&]() {
+        if (mcts_iteration_counter >= budget.max_iterations ||
+            tree[root].proof.load(std::memory_order_relaxed) != Proof::Unknown) {
+            return false;
+        }
+        if (budget.max_time.count() > 0) {
+            round_budget.max_time = budget.max_time - std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                          std::chrono::steady_clock::now() - start);
+            return round_budget.max_time.count() > 0;
+        }
+        return true;
+    };
+    while (candidates.size() > 1 && may_continue()) {
+        // What is left of the budget is spread over the remaining rounds, so the last one spends it all
+        const int remaining = budget.max_iterations - mcts_iteration_counter;
+        const int visits_per_move = std::max(1, remaining / (rounds_left * static_cast<int>(candidates.size())));
+        std::vector<EdgeIndex> schedule;
+        schedule.reserve(visits_per_move * candidates.size());
+        for (int visit = 0; visit < visits_per_move; ++visit) {
+            for (std::uint32_t i : candidates) {
+                schedule.push_back(first_edge + i);
+            }
+        }
+        perform_mcts_iterations(round_budget, mcts_iteration_counter, board, &schedule);
+
+        sort_candidates();
+        candidates.resize((candidates.size() + 1) / 2);
+        rounds_left = std::max(1, rounds_left - 1);
+    }
+
+    // Simulations left by the rounding (or all of them with a single candidate) go to the chosen move
+    if (may_continue()) {
+        const std::vector<EdgeIndex> schedule(budget.max_iterations - mcts_iteration_counter,
+                                              first_edge + candidates.front());
+        perform_mcts_iterations(round_budget, mcts_iteration_counter, board, &schedule);
+    }
+
+    sort_candidates();
+    gumbel_choice = first_edge + candidates.front();
+    return mcts_iteration_counter;
+}
+
+float Mcts_agent::gumbel_sigma(EdgeIndex edge, std::int32_t max_visits) const {
+    if (edges.visit_count(edge) == 0) {
+        return 0.0f;
+    }
+    // Values in [-1, 1] normalized to [0, 1]; proven moves stay at +/-inf
+    float normalized_q = (edges.mean_value(edge) + 1.0f) / 2.0f;
+    return (gumbel_c_visit + max_visits) * gumbel_c_scale * normalized_q;
+}
+
+torch::Tensor Mcts_agent::get_improved_policy() const {
+    const Node& root_node = tree[root];
+    const EdgeIndex first_edge = root_node.first_edge;
+
+    // Mixed value completing unvisited moves: network value and prior-weighted mean of visited moves
+    std::int32_t max_visits = 0;
+    double total_visits = 0.0;
+    double visited_prior = 0.0;
+    double visited_weighted_q = 0.0;
+    for (EdgeIndex edge = first_edge; edge < first_edge + root_node.num_edges; ++edge) {
+        std::int32_t visits = edges.visit_count(edge);
+        if (visits == 0) {
+            continue;
+        }
+        max_visits = std::max(max_visits, visits);
+        total_visits += visits;
+        visited_prior += edges.prior(edge);
+        visited_weighted_q += edges.prior(edge) * std::clamp(edges.mean_value(edge), -1.0f, 1.0f);
+    }
+    double mixed_value = root_node.value_from_nn;
+    if (visited_prior > 0.0) {
+        mixed_value = (mixed_value + total_visits * visited_weighted_q / visited_prior) / (1.0 + total_visits);
+    }
+    const float mixed_sigma =
+        (gumbel_c_visit + max_visits) * gumbel_c_scale * static_cast<float>((mixed_value + 1.0) / 2.0);
+
+    std::vector<float> logits(root_node.num_edges);
+    float max_logit = -std::numeric_limits<float>::infinity();
+    for (std::uint32_t i = 0; i < root_node.num_edges; ++i) {
+        EdgeIndex edge = first_edge + i;
+        float sigma = edges.visit_count(edge) > 0 ? gumbel_sigma(edge, max_visits) : mixed_sigma;
+        logits[i] = std::log(std::max(edges.prior(edge), 1e-8f)) + sigma;
+        max_logit = std::max(max_logit, logits[i]);
+    }
+
+    torch::Tensor all_moves = torch::zeros({Board::policy_size}, torch::kFloat32);
+    float* data = all_moves.data_ptr<float>();
+    if (std::isinf(max_logit)) {
+        // Proven win(s): share the policy between the winning moves
+        for (std::uint32_t i = 0; i < root_node.num_edges; ++i) {
+            data[edges.move_index(first_edge + i)] = logits[i] == max_logit ? 1.0f : 0.0f;
+        }
+    } else {
+        for (std::uint32_t i = 0; i < root_node.num_edges; ++i) {
+            data[edges.move_index(first_edge + i)] = std::exp(logits[i] - max_logit);
+        }
+    }
+    return all_moves / all_moves.sum();
+}
+
+void Mcts_agent::stop_pondering() {
+    if (ponder_thread.joinable()) {
+        stop_requested.store(true, std::memory_order_relaxed);
+        ponder_thread.join();
+    }
+    stop_requested.store(false, std::memory_order_relaxed);
+}
+
+void Mcts_agent::export_tree(const std::string& path) const {
+    if (parallel_mode == ParallelMode::Root) {
+        ensemble.front()->export_tree(path);
+        return;
+    }
+
+    TreeDumpHeader header{};
+    std::copy(std::begin(kTreeDumpMagic), std::end(kTreeDumpMagic), header.magic);
+    header.root = root;
+    header.node_count = root == kNullNode ? 0 : tree.size();
+    header.edge_count = root == kNullNode ? 0 : edges.size();
+
+    std::vector<TreeDumpNode> dumped_nodes(header.node_count);
+    for (NodeIndex node = 0; node < header.node_count; ++node) {
+        const Node& source = tree[node];
+        TreeDumpNode& dumped = dumped_nodes[node];
+        dumped.value_from_nn = source.value_from_nn;
+        dumped.visit_count = source.visit_count.load(std::memory_order_relaxed);
+        dumped.expanded = source.expanded() ? 1 : 0;
+        dumped.first_edge = dumped.expanded ? source.first_edge : 0;
+        dumped.num_edges = dumped.expanded ? source.num_edges : 0;
+        dumped.player = static_cast<std::uint8_t>(source.player);
+        dumped.proof = static_cast<std::uint8_t>(source.proof.load(std::memory_order_relaxed));
+    }
 
-    logger->log_timer_ran_out(mcts_iteration_counter);
-    logger->log_root_stats(root->visit_count, root->child_nodes.size());
+    std::vector<TreeDumpEdge> dumped_edges(header.edge_count);
+    for (EdgeIndex edge = 0; edge < header.edge_count; ++edge) {
+        TreeDumpEdge& dumped = dumped_edges[edge];
+        dumped.move_index = edges.move_index(edge);
+        dumped.prior = edges.prior(edge);
+        dumped.visit_count = edges.visit_count(edge);
+        dumped.value_sum = edges.value_sum(edge);
+        dumped.child = edges.child(edge);
+    }
 
-    std::shared_ptr<Node> best_child = select_best_child(root);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(dumped_nodes.data()),
+               static_cast<std::streamsize>(dumped_nodes.size() * sizeof(TreeDumpNode)));
+    file.write(reinterpret_cast<const char*>(dumped_edges.data()),
+               static_cast<std::streamsize>(dumped_edges.size() * sizeof(TreeDumpEdge)));
+    if (!file) {
+        throw std::runtime_error("Cannot write the tree dump " + path);
+    }
+}
 
-    logger->log_best_child_chosen(mcts_iteration_counter, best_child->move, best_child->value_from_mcts , best_child->visit_count);
-    logger->log_mcts_end();
+void Mcts_agent::start_pondering(const Board& board, EdgeIndex best_edge) {
+    const std::array<int, 4> move = edge_move(best_edge);
+    Cell_state next_player = tree[root].player;
+    Board next_board = board;
+    next_board.make_move(move[0], move[1], move[2], move[3], next_player);
+    if (next_board.check_winner() != Cell_state::Empty) {
+        return;
+    }
+    if (move[3] < 1) {
+        next_player = (next_player == Cell_state::X ? Cell_state::O : Cell_state::X);
+        next_board.clear_state();
+    }
 
-    for (const auto& child : root->child_nodes) {
-        float avg_value = (child->visit_count > 0) ? 
-            child->acc_value / child->visit_count : 0.0f;
-            logger->log_child_node_stats(child->move, child->acc_value, 
-                                     child->visit_count, child->prior_proba);
+    NodeIndex next_root = materialize_child(root, best_edge, next_board.hash(next_player));
+    if (next_root == kNullNode) {
+        return;
     }
 
-    torch::Tensor policy_from_mcts = get_policy_logits(root);
+    compact_tree(next_root);
+    root_board = std::move(next_board);
+
+    ponder_thread = std::thread([this]() {
+        pin_search_thread(0);
+        Node& root_node = tree[root];
+        ExpansionState expected = ExpansionState::Unexpanded;
+        if (root_node.expansion_state.compare_exchange_strong(expected, ExpansionState::Expanding,
+                                                              std::memory_order_acq_rel)) {
+            initiate_and_run_nn(root, *root_board, false, 0.0f, 0.0f);
+        }
+
+        // Leave room for the nodes of the next search
+        SearchBudget ponder_budget;
+        ponder_budget.max_nodes =
+            tree.capacity() - std::min(static_cast<std::size_t>(number_iteration), tree.capacity() / 2);
+        ponder_budget.early_stop = false;
+        int ponder_iteration_counter = 0;
+        perform_mcts_iterations(ponder_budget, ponder_iteration_counter, *root_board);
+    });
+}
+
+NodeIndex Mcts_agent::find_reusable_root(const Board& board, Cell_state player) const {
+    if (root == kNullNode || !root_board) {
+        return kNullNode;
+    }
 
-    return {best_child->move, policy_from_mcts};
+    // Every node of the kept tree is in the transposition table, whatever the move order
+    NodeIndex node = transpositions.find(board.hash(player));
+    if (node == kNullNode || !tree[node].expanded()) {
+        return kNullNode;
+    }
+    return node;
+}
+
+void Mcts_agent::compact_tree(NodeIndex new_root, int min_visits) {
+    spare_tree.clear();
+    spare_edges.clear();
+    transpositions.clear();
+
+    // Breadth-first copy; a node reached by several edges is copied once
+    std::vector<NodeIndex> copy_of(tree.size(), kNullNode);
+    std::vector<NodeIndex> pending{new_root};
+    copy_of[new_root] = spare_tree.allocate(1);
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        const NodeIndex current = pending[i];
+        const Node& source = tree[current];
+        const NodeIndex copy = copy_of[current];
+        Node& target = spare_tree[copy];
+        if (current == new_root) {
+            target.reset(source.player, source.key, source.value_from_nn, kNullNode, kNullEdge);
+        }
+        target.visit_count.store(source.visit_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        target.proof.store(source.proof.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        transpositions.insert(source.key, copy);
+
+        if (!source.expanded()) {
+            continue;
+        }
+        EdgeIndex first_edge = spare_edges.allocate(source.num_edges);
+        for (std::uint32_t k = 0; k < source.num_edges; ++k) {
+            spare_edges.copy(edges, source.first_edge + k, first_edge + k);
+            NodeIndex child = edges.child(source.first_edge + k);
+            if (child == kNullNode) {
+                continue;
+            }
+            if (copy_of[child] == kNullNode) {
+                const Node& dropped = tree[child];
+                if (dropped.visit_count.load(std::memory_order_relaxed) < min_visits &&
+                    dropped.proof.load(std::memory_order_relaxed) == Proof::Unknown) {
+                    continue;  // The edge keeps its statistics, the child is recreated if selected again
+                }
+                // First edge reaching the child becomes its recorded parent
+                copy_of[child] = spare_tree.allocate(1);
+                const Node& child_source = tree[child];
+                spare_tree[copy_of[child]].reset(child_source.player, child_source.key, child_source.value_from_nn,
+                                                 copy, first_edge + k);
+                pending.push_back(child);
+            }
+            spare_edges.set_child(first_edge + k, copy_of[child]);
+        }
+        target.first_edge = first_edge;
+        target.num_edges = source.num_edges;
+        target.expansion_state.store(ExpansionState::Expanded, std::memory_order_relaxed);
+    }
+
+    tree.swap(spare_tree);
+    edges.swap(spare_edges);
+    root = copy_of[new_root];
+}
+
+bool Mcts_agent::tree_nearly_full() const {
+    const std::size_t threads = static_cast<std::size_t>(num_threads);
+    return tree.size() + threads >= tree.capacity() ||
+           edges.size() + threads * edges_per_iteration >= edges.capacity();
+}
+
+void Mcts_agent::recycle_tree() {
+    // Visit count of the node ranked at half the capacity: keeping the nodes
+    // visited more often frees at least half of the arena
+    const std::size_t keep = tree.capacity() / 2;
+    const std::size_t before = tree.size();
+    int min_visits = 0;
+    if (before > keep) {
+        std::vector<int> visits(before);
+        for (std::size_t i = 0; i < before; ++i) {
+            visits[i] = tree[static_cast<NodeIndex>(i)].visit_count.load(std::memory_order_relaxed);
+        }
+        std::nth_element(visits.begin(), visits.begin() + keep, visits.end(), std::greater<int>());
+        min_visits = visits[keep] + 1;
+    }
+
+    // The root is copied first, so its edges keep the range starting at 0
+    compact_tree(root, min_visits);
+    counters.recycled_nodes.fetch_add(before - tree.size(), std::memory_order_relaxed);
+}
+
+void Mcts_agent::apply_dirichlet_noise(NodeIndex node, float dirichlet_alpha, float exploration_fraction) {
+    const Node& noisy_node = tree[node];
+    if (noisy_node.num_edges == 0) {
+        return;
+    }
+
+    std::vector<float> noise = generate_dirichlet_noise(noisy_node.num_edges, dirichlet_alpha);
+    for (std::uint32_t i = 0; i < noisy_node.num_edges; ++i) {
+        EdgeIndex edge = noisy_node.first_edge + i;
+        edges.set_prior(edge, (1.0f - exploration_fraction) * edges.prior(edge) + exploration_fraction * noise[i]);
+    }
+
+    if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+        logger->log_dirichlet_noise_applied(dirichlet_alpha, exploration_fraction);
+    }
 }
 
 void Mcts_agent::random_move(Board& board, Cell_state player, int random_move_number) {
@@ -133,253 +1213,534 @@ void Mcts_agent::random_move(Board& board, Cell_state player, int random_move_nu
     }
 }
 
-float Mcts_agent::initiate_and_run_nn(const std::shared_ptr<Node>& node, const Board& board,
+float Mcts_agent::initiate_and_run_nn(NodeIndex node, const Board& board,
                                       bool add_dirichlet_noise = false, float dirichlet_alpha = 0.4,
                                       float exploration_fraction = 0.25) {
-    Cell_state current_player = node->player;
-    Cell_state actual_player = node->player;
-
-    torch::Tensor input = board.to_tensor(current_player).unsqueeze(0);
-    torch::Tensor legal_mask = board.get_legal_mask(current_player).unsqueeze(0);
-
-    auto [policy, value] = agent->predict(input, legal_mask);
+    const auto expansion_start = std::chrono::steady_clock::now();
+    std::int64_t nn_ns = 0;
+    Cell_state current_player = tree[node].player;
+
+    // Sparse policy as (flattened move index, prior), from the cache or from the network
+    std::vector<std::pair<std::uint16_t, float>> move_with_logit;
+    float value;
+    const std::uint64_t position_key = board.hash(current_player);
+    if (!lookup_evaluation(position_key, value, move_with_logit)) {
+        BufferLease lease = agent->buffers(1);
+        InferenceBuffers& buffers = *lease;
+        board.write_planes(current_player, buffers.input(0));
+        board.write_legal_mask(current_player, buffers.legal_mask(0));
+
+        const auto nn_start = std::chrono::steady_clock::now();
+        agent->evaluate(buffers, 1);
+        value = buffers.value(0);
+        nn_ns = nanoseconds_since(nn_start);
+        counters.nn_ns.fetch_add(nn_ns, std::memory_order_relaxed);
+        // One position per network call on this path
+        record_evaluation(1, 1);
+
+        move_with_logit = sparse_policy(buffers.policy(0));
+        eval_cache->store(position_key, agent->generation(), value, move_with_logit);
+    }
 
-    
+    expand_node(node, value, move_with_logit, add_dirichlet_noise, dirichlet_alpha, exploration_fraction);
+    counters.expansion_ns.fetch_add(nanoseconds_since(expansion_start) - nn_ns, std::memory_order_relaxed);
 
-    std::vector<std::pair<std::array<int, 4>, float>> move_with_logit = get_moves_with_probs(policy);
-    
-    logger->log_nn_evaluation(node->move, value.item<float>(), move_with_logit.size());
+    return value;
+}
 
-    std::vector<float> noise;
-    if (add_dirichlet_noise && !move_with_logit.empty()) {
-        noise = generate_dirichlet_noise(move_with_logit.size(), dirichlet_alpha);
+bool Mcts_agent::lookup_evaluation(std::uint64_t position_key, float& value,
+                                   std::vector<std::pair<std::uint16_t, float>>& move_with_logit) {
+    if (!eval_cache->lookup(position_key, agent->generation(), value, move_with_logit)) {
+        return false;
+    }
+    counters.cache_hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
 
-        for (size_t i = 0; i < move_with_logit.size(); ++i) {
-            move_with_logit[i].second =
-                (1.0 - exploration_fraction) * move_with_logit[i].second + exploration_fraction * noise[i];
-        }
+std::vector<std::pair<std::uint16_t, float>> Mcts_agent::sparse_policy(std::span<const float> policy) {
+    std::vector<std::pair<std::uint16_t, float>> move_with_logit;
+    float sum = 0.0f;
+    for (std::size_t index = 0; index < policy.size(); ++index) {
+        const float p = std::exp(policy[index]);
+        if (p <= 0.0f) continue;  // Masked out
+        move_with_logit.emplace_back(static_cast<std::uint16_t>(index), p);
+        sum += p;
+    }
+    for (auto& entry : move_with_logit) {
+        entry.second /= sum;
+    }
+    return move_with_logit;
+}
 
-        logger->log_dirichlet_noise_applied(dirichlet_alpha, exploration_fraction);
+void Mcts_agent::expand_node(NodeIndex node, float value,
+                             const std::vector<std::pair<std::uint16_t, float>>& move_with_logit,
+                             bool add_dirichlet_noise, float dirichlet_alpha, float exploration_fraction) {
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_nn_evaluation(node_move(node), value, move_with_logit.size());
     }
 
-    // For each valid move, create a new child node
-    int idx = 0;
-    for (const auto& [move, logit] : move_with_logit) {
-        if (move[3] < 1) {
-            actual_player = (current_player == Cell_state::X ? Cell_state::O : Cell_state::X);
-        } else {
-            actual_player = current_player;
+    // For each valid move, record a compact (move, prior) edge; child nodes are created on first selection
+    EdgeIndex first_edge = edges.allocate(move_with_logit.size());
+    if (first_edge != kNullEdge) {
+        EdgeIndex edge = first_edge;
+        for (const auto& [move_index, logit] : move_with_logit) {
+            edges.reset(edge, move_index, logit);
+            edge++;
         }
-
-        std::shared_ptr<Node> new_child =
-            std::make_shared<Node>(actual_player, std::array<int, 4>(move), logit, 0.0, node);
-        node->child_nodes.push_back(new_child);
-        idx++;
+        tree[node].first_edge = first_edge;
+        tree[node].num_edges = static_cast<std::uint32_t>(move_with_logit.size());
+    } else if (!move_with_logit.empty()) {
+        // Edge arena full: the node stays a leaf
+        counters.arena_full.fetch_add(1, std::memory_order_relaxed);
     }
 
-    logger->log_expansion(node->move, node->child_nodes.size());
-    node->value_from_nn = value.item<float>();
-    node->expanded = true;
+    if (add_dirichlet_noise) {
+        apply_dirichlet_noise(node, dirichlet_alpha, exploration_fraction);
+    }
 
-    return value.item<float>();
+    Node& expanded_node = tree[node];
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_expansion(node_move(node), expanded_node.num_edges);
+    }
+    expanded_node.value_from_nn = value;
+    // Publish the children and the evaluation to the other search threads
+    expanded_node.expansion_state.store(ExpansionState::Expanded, std::memory_order_release);
 }
 
-void Mcts_agent::perform_mcts_iterations(int number_iteration, int& mcts_iteration_counter, const Board& board) {
-    int count = 0;
-    while (mcts_iteration_counter < number_iteration) {
-        logger->log_iteration_number(mcts_iteration_counter + 1);
-
-        logger->log_step("START SELECTION FROM", root->move);
-        auto [chosen_child, new_board] = select_child_for_playout(root, board);
-        logger->log_step("SELECTED", chosen_child->move);
+void Mcts_agent::perform_mcts_iterations(const SearchBudget& budget, int& mcts_iteration_counter,
+                                         const Board& board, const std::vector<EdgeIndex>* root_schedule) {
+    const auto start = std::chrono::steady_clock::now();
+    const int first_iteration = mcts_iteration_counter;
+    int max_iterations = budget.max_iterations > 0 ? budget.max_iterations : std::numeric_limits<int>::max();
+    if (root_schedule != nullptr) {
+        max_iterations = std::min(max_iterations, first_iteration + static_cast<int>(root_schedule->size()));
+    }
+    std::atomic<int> next_iteration(mcts_iteration_counter);
+    std::atomic<int> completed(mcts_iteration_counter);
+    std::atomic<bool> stop(should_stop_search(budget, mcts_iteration_counter, start));
+    std::atomic<bool> recycle(false);
+    bool may_recycle = memory_policy == TreeMemoryPolicy::Recycle;
+
+    auto worker = [&]() {
+        int iteration;
+        while (!stop.load(std::memory_order_relaxed) && !recycle.load(std::memory_order_relaxed) &&
+               (iteration = next_iteration.fetch_add(1, std::memory_order_relaxed)) < max_iterations) {
+            run_simulation(iteration, board,
+                           root_schedule != nullptr ? (*root_schedule)[iteration - first_iteration] : kNullEdge);
+            int done = completed.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (should_stop_search(budget, done, start)) {
+                stop.store(true, std::memory_order_relaxed);
+            } else if (may_recycle && tree_nearly_full()) {
+                recycle.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
 
-        float value_from_nn = simulate_random_playout(chosen_child, new_board);
+    auto run_workers = [&]() {
+        if (num_threads == 1) {
+            worker();
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(num_threads);
+        for (int i = 0; i < num_threads; ++i) {
+            workers.emplace_back([&worker, i]() {
+                pin_search_thread(i);
+                worker();
+            });
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    };
 
-        logger->log_step("BACKPROPAGATION", chosen_child->move);
-        backpropagate(chosen_child, value_from_nn);
-        
-        logger->log_step("FINAL STATS", chosen_child->move);
-        for (const auto& child : root->child_nodes) {
-            logger->log_child_node_stats(child->move, child->acc_value, child->visit_count, child->prior_proba);
+    run_workers();
+    // Memory cap reached: once every thread is out of the tree, drop the least
+    // visited subtrees and resume the search in the room freed
+    while (recycle.load() && !stop.load()) {
+        recycle_tree();
+        recycle.store(false);
+        if (tree_nearly_full()) {
+            may_recycle = false;  // Nothing left to drop: only refine from now on
         }
-        mcts_iteration_counter++;
+        run_workers();
     }
+    mcts_iteration_counter = completed.load();
 }
 
-torch::Tensor Mcts_agent::get_policy_logits(const std::shared_ptr<Node>& parent_node) const {
-    const int X = 5;
-    const int Y = 10;
-    const int DIR = 9;
-    const int TAR = 4;
-    const int total_size = X * Y * DIR * TAR;
+bool Mcts_agent::should_stop_search(const SearchBudget& budget, int completed,
+                                    std::chrono::steady_clock::time_point start) const {
+    if (stop_requested.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (tree[root].proof.load(std::memory_order_relaxed) != Proof::Unknown) {
+        return true;  // The outcome of the position is proven
+    }
+    if (budget.max_iterations > 0 && completed >= budget.max_iterations) {
+        return true;
+    }
+    if (budget.max_nodes > 0 && tree.size() >= budget.max_nodes) {
+        return true;
+    }
 
-    torch::Tensor all_moves = torch::zeros({total_size}, torch::kFloat32);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    if (budget.max_time.count() > 0 && elapsed >= budget.max_time) {
+        return true;
+    }
 
-    //(x,y,dir,tar) → index
-    auto index = [&](int x, int y, int dir, int tar) -> int {
-        int dir_idx = dir - 1;
-        int tar_idx = tar + 1;
-        return x * (Y * DIR * TAR) + y * (DIR * TAR) + dir_idx * TAR + tar_idx;
-    };
+    if (!budget.early_stop || completed == 0) {
+        return false;
+    }
 
-    for (const auto& child : parent_node->child_nodes) {
-        auto m = child->move;
-        float visit_ratio = (child->visit_count > 0) ? (child->visit_count / parent_node->visit_count) : 0.0;
+    const Node& root_node = tree[root];
+    if (root_node.num_edges <= 1) {
+        return true;  // Forced move
+    }
 
-        int idx = index(m[0], m[1], m[2], m[3]);
-        if (idx >= 0 && idx < total_size) all_moves[idx] = visit_ratio;
+    // Simulations that can still run: what is left of the iteration budget,
+    // and what the current rate allows in the remaining time
+    double remaining = std::numeric_limits<double>::infinity();
+    if (budget.max_iterations > 0) {
+        remaining = budget.max_iterations - completed;
+    }
+    if (budget.max_time.count() > 0) {
+        double elapsed_seconds = std::chrono::duration<double>(elapsed).count();
+        double remaining_seconds = std::chrono::duration<double>(budget.max_time - elapsed).count();
+        remaining = std::min(remaining, completed / std::max(elapsed_seconds, 1e-9) * remaining_seconds);
+    }
+    if (!std::isfinite(remaining)) {
+        return false;
     }
 
-    return all_moves;
+    // Lead of the most visited child, the move select_best_child picks when early_stop is set;
+    // proven losses are never picked while another move is left
+    std::int32_t best_visits = 0;
+    std::int32_t second_visits = 0;
+    for (EdgeIndex edge = root_node.first_edge; edge < root_node.first_edge + root_node.num_edges; ++edge) {
+        if (edges.value_sum(edge) == -std::numeric_limits<float>::infinity()) {
+            continue;
+        }
+        std::int32_t visits = edges.visit_count(edge);
+        if (visits > best_visits) {
+            second_visits = best_visits;
+            best_visits = visits;
+        } else if (visits > second_visits) {
+            second_visits = visits;
+        }
+    }
+    return best_visits - second_visits > remaining;
 }
 
-std::vector<std::pair<std::array<int, 4>, float>> Mcts_agent::get_moves_with_probs(
-    const torch::Tensor& log_probs_tensor) const {
-    const int X = 5;
-    const int Y = 10;
-    const int DIR = 9;
-    const int TAR = 4;
-    const int total = X * Y * DIR * TAR;
-
-    torch::Tensor probs = torch::exp(log_probs_tensor).to(torch::kCPU).contiguous().view({total});
-    const float* data = probs.data_ptr<float>();
+void Mcts_agent::record_evaluation(std::size_t batch_size, std::size_t batch_capacity) {
+    counters.nn_evaluations.fetch_add(1, std::memory_order_relaxed);
+    counters.batch_rows.fetch_add(batch_size, std::memory_order_relaxed);
+    counters.batch_slots.fetch_add(std::max(batch_size, batch_capacity), std::memory_order_relaxed);
+}
 
-    std::vector<std::pair<std::array<int, 4>, float>> moves;
-    moves.reserve(total);
+void Mcts_agent::record_depth(int depth) {
+    counters.depth_sum.fetch_add(depth, std::memory_order_relaxed);
+    int max_depth = counters.max_depth.load(std::memory_order_relaxed);
+    while (depth > max_depth &&
+           !counters.max_depth.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+    }
+}
 
-    float sum = 0.0f;
+void Mcts_agent::run_simulation(int iteration_number, const Board& board, EdgeIndex forced_root_edge) {
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_iteration_number(iteration_number + 1);
+        logger->log_step("START SELECTION FROM", node_move(root));
+    }
+    std::vector<std::pair<NodeIndex, EdgeIndex>> path;
+    auto phase_start = std::chrono::steady_clock::now();
+    auto [chosen_child, new_board] = select_child_for_playout(root, board, path, forced_root_edge);
+    counters.selection_ns.fetch_add(nanoseconds_since(phase_start), std::memory_order_relaxed);
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_step("SELECTED", node_move(chosen_child));
+    }
 
-    for (int idx = 0; idx < total; idx++) {
-        float p = data[idx];
-        if (p <= 0.0f) continue;
+    record_depth(static_cast<int>(path.size()));
 
-        int t = idx;
-        int x = t / (Y * DIR * TAR);
-        t %= (Y * DIR * TAR);
-        int y = t / (DIR * TAR);
-        t %= (DIR * TAR);
-        int dir = (t / TAR) + 1;
-        int tar = (t % TAR) - 1;
+    // A position repeated on the path closes a cycle of the graph: score it as a draw
+    bool repeated = std::any_of(path.begin(), path.end(),
+                                [&](const auto& step) { return step.first == chosen_child; });
+    float value_from_nn = repeated ? 0.0f : simulate_random_playout(chosen_child, new_board);
 
-        std::array<int, 4> move = {x, y, dir, tar};
-        moves.emplace_back(move, p);
-        sum += p;
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_step("BACKPROPAGATION", node_move(chosen_child));
     }
+    phase_start = std::chrono::steady_clock::now();
+    backpropagate(path, value_from_nn);
+    propagate_proof(path);
+    counters.backup_ns.fetch_add(nanoseconds_since(phase_start), std::memory_order_relaxed);
 
-    for (auto& m : moves) {
-        m.second /= sum;
+    if constexpr (log_compiled(LogLevel::STEPS_ONLY)) {
+        logger->log_step("FINAL STATS", node_move(chosen_child));
+    }
+    if constexpr (log_compiled(LogLevel::ROOT_STATS)) {
+        // Skip the scan of the root children unless the level prints them
+        if (logger->get_log_level() >= LogLevel::ROOT_STATS) {
+            const Node& root_node = tree[root];
+            for (EdgeIndex edge = root_node.first_edge; edge < root_node.first_edge + root_node.num_edges; ++edge) {
+                logger->log_child_node_stats(edge_move(edge), edges.value_sum(edge), edges.visit_count(edge),
+                                             edges.prior(edge));
+            }
+        }
     }
-
-    return moves;
 }
 
-std::pair<std::shared_ptr<Mcts_agent::Node>, Board> Mcts_agent::select_child_for_playout(
-    const std::shared_ptr<Node>& parent_node, Board board) {
-    std::shared_ptr<Node> current = parent_node;
-    Cell_state current_player = current->player;
+torch::Tensor Mcts_agent::get_policy_logits(NodeIndex parent_node) const {
+    torch::Tensor all_moves = torch::zeros({Board::policy_size}, torch::kFloat32);
+    float* data = all_moves.data_ptr<float>();
 
-    while (current->expanded && !current->child_nodes.empty()) {
-        // Pick best child
-        std::shared_ptr<Node> best_child = current->child_nodes[0];
-        double max_score = calculate_puct_score(best_child, current);
+    // Edges already store the flattened policy index of their move
+    const Node& parent = tree[parent_node];
+    float parent_visits = static_cast<float>(parent.visit_count.load(std::memory_order_relaxed));
+    for (EdgeIndex edge = parent.first_edge; edge < parent.first_edge + parent.num_edges; ++edge) {
+        std::int32_t visits = edges.visit_count(edge);
+        float visit_ratio = (visits > 0) ? (visits / parent_visits) : 0.0f;
 
-        for (size_t i = 1; i < current->child_nodes.size(); i++) {
-            auto& child = current->child_nodes[i];
-            double score = calculate_puct_score(child, current);
+        data[edges.move_index(edge)] = visit_ratio;
+    }
 
-            float q_value = child->acc_value / child->visit_count;
-            float u_value = score - q_value;
-            logger->log_puct_details(child->move, q_value, u_value,
-                                        child->prior_proba, child->visit_count,
-                                        current->visit_count);
-            if (score > max_score) {
-                max_score = score;
-                best_child = child;
+    return all_moves;
+}
+
+std::pair<NodeIndex, Board> Mcts_agent::select_child_for_playout(NodeIndex parent_node, Board board,
+                                                                  std::vector<std::pair<NodeIndex, EdgeIndex>>& path,
+                                                                  EdgeIndex forced_first_edge) {
+    NodeIndex current = parent_node;
+    Cell_state current_player = tree[current].player;
+    bool log_puct = false;
+    if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+        log_puct = logger->get_log_level() == LogLevel::EVERYTHING;
+    }
+
+    // Solved nodes are not searched further: they are scored as leaves
+    while (tree[current].expanded() && tree[current].num_edges > 0 &&
+           tree[current].proof.load(std::memory_order_relaxed) == Proof::Unknown) {
+        const Node& current_node = tree[current];
+        const EdgeIndex first_edge = current_node.first_edge;
+
+        if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+            if (log_puct) {
+                for (EdgeIndex edge = first_edge; edge < first_edge + current_node.num_edges; ++edge) {
+                    double score = calculate_puct_score(edge, current_node);
+                    float q_value = edges.value_sum(edge) / edges.visit_count(edge);
+                    float u_value = score - q_value;
+                    logger->log_puct_details(edge_move(edge), q_value, u_value, edges.prior(edge),
+                                             edges.visit_count(edge), current_node.visit_count);
+                }
             }
         }
 
-        logger->log_selected_child(best_child->move, max_score);
+        EdgeIndex best_edge;
+        float max_score = 0.0f;
+        if (current == parent_node && forced_first_edge != kNullEdge) {
+            // The root move is scheduled by the Gumbel root
+            best_edge = forced_first_edge;
+        } else {
+            // Pick best child: sqrt(N) is computed once per node, the scan is vectorized
+            // over a snapshot of the statistics other threads keep updating
+            thread_local std::vector<std::int32_t> visit_snapshot;
+            thread_local std::vector<float> value_snapshot;
+            const std::uint32_t num_edges = current_node.num_edges;
+            if (visit_snapshot.size() < num_edges) {
+                visit_snapshot.resize(num_edges);
+                value_snapshot.resize(num_edges);
+            }
+            edges.snapshot(first_edge, num_edges, visit_snapshot.data(), value_snapshot.data());
+            float c_sqrt_n = static_cast<float>(
+                exploration_factor * std::sqrt(current_node.visit_count.load(std::memory_order_relaxed)));
+            best_edge = first_edge + select_puct_child(edges.priors() + first_edge, visit_snapshot.data(),
+                                                       value_snapshot.data(), num_edges, c_sqrt_n, max_score);
+        }
+        const std::array<int, 4> best_move = edge_move(best_edge);
+        Cell_state next_player = current_player;
+        auto apply_best_move = [&](Board& target) {
+            target.make_move(best_move[0], best_move[1], best_move[2], best_move[3], current_player);
+            if (best_move[3] < 1) {
+                // Switch player
+                next_player = (current_player == Cell_state::X ? Cell_state::O : Cell_state::X);
+                target.clear_state();
+            }
+        };
+
+        NodeIndex best_child = edges.child(best_edge);
+        if (best_child == kNullNode) {
+            // First visit of the edge: its position is needed to find transpositions
+            Board child_board = board;
+            apply_best_move(child_board);
+            best_child = materialize_child(current, best_edge, child_board.hash(next_player));
+            if (best_child == kNullNode) {
+                // Node arena full: stop here and refine the existing tree
+                counters.arena_full.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            board = std::move(child_board);
+        } else {
+            apply_best_move(board);
+        }
 
-        // Apply move
-        board.make_move(best_child->move[0], best_child->move[1], best_child->move[2], best_child->move[3],
-                        current_player);
+        if constexpr (log_compiled(LogLevel::SELECTION_ONLY)) {
+            logger->log_selected_child(best_move, max_score);
+        }
 
-        if (best_child->move[3] < 1) {
-            // Switch player
-            current_player = (current_player == Cell_state::X ? Cell_state::O : Cell_state::X);
-            board.clear_state();
+        // Virtual loss: make this branch look visited and lost until backpropagation
+        if (virtual_loss > 0) {
+            edges.add(best_edge, virtual_loss, -static_cast<float>(virtual_loss));
+            tree[best_child].visit_count.fetch_add(virtual_loss, std::memory_order_relaxed);
         }
 
+        path.emplace_back(current, best_edge);
+        current_player = next_player;
         current = best_child;
+
+        // Cycle guard: stop when the graph leads back to a position of the path
+        if (std::any_of(path.begin(), path.end(), [&](const auto& step) { return step.first == current; })) {
+            break;
+        }
     }
 
     return {current, board};
 }
 
-double Mcts_agent::calculate_puct_score(const std::shared_ptr<Node>& child_node,
-                                        const std::shared_ptr<Node>& parent_node) {
-    return static_cast<double>(child_node->value_from_mcts +
-                               exploration_factor * child_node->prior_proba *
-                                   (std::sqrt(parent_node->visit_count) / (child_node->visit_count + 1)));
+double Mcts_agent::calculate_puct_score(EdgeIndex child_edge, const Node& parent_node) const {
+    return static_cast<double>(edges.mean_value(child_edge) +
+                               exploration_factor * edges.prior(child_edge) *
+                                   (std::sqrt(parent_node.visit_count.load(std::memory_order_relaxed)) /
+                                    (edges.visit_count(child_edge) + 1)));
 }
 
-float Mcts_agent::simulate_random_playout(const std::shared_ptr<Node>& node, Board board) {
+float Mcts_agent::simulate_random_playout(NodeIndex node, Board board) {
     // Start the simulation
+    Node& leaf = tree[node];
+    Proof proof = leaf.proof.load(std::memory_order_relaxed);
+    if (proof != Proof::Unknown) {
+        float value = proof == Proof::Win ? 1.0f : -1.0f;
+        if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+            logger->log_simulation_end(value);
+        }
+        return value;
+    }
 
     Cell_state winner = board.check_winner();
-    if (winner == root->player) {
-        logger->log_simulation_end(1.0);
+    if (winner == leaf.player) {
+        leaf.proof.store(Proof::Win, std::memory_order_relaxed);
+        if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+            logger->log_simulation_end(1.0);
+        }
         return 1.0;  // current player won
 
     } else if (winner == Cell_state::Empty) {
-        float value = initiate_and_run_nn(node, board);
-        logger->log_simulation_end(value);
+        ExpansionState expected = ExpansionState::Unexpanded;
+        float value;
+        if (leaf.expansion_state.compare_exchange_strong(expected, ExpansionState::Expanding,
+                                                         std::memory_order_acq_rel)) {
+            value = initiate_and_run_nn(node, board);
+        } else {
+            // Another thread owns the expansion (or the node was left childless
+            // because the arena was full): reuse its evaluation
+            while (!leaf.expanded()) {
+                std::this_thread::yield();
+            }
+            value = leaf.value_from_nn;
+        }
+        if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+            logger->log_simulation_end(value);
+        }
         return value;
     } else {
-        logger->log_simulation_end(-1.0);
+        leaf.proof.store(Proof::Loss, std::memory_order_relaxed);
+        if constexpr (log_compiled(LogLevel::EVERYTHING)) {
+            logger->log_simulation_end(-1.0);
+        }
         return -1.0;  // opponent won
     }
 }
 
-void Mcts_agent::backpropagate(std::shared_ptr<Node>& node, float value) {
-    // Start backpropagation
-    std::shared_ptr<Node> current_node = node;
-    while (current_node != nullptr) {
-        // Lock the node's mutex before updating its data
-        std::lock_guard<std::mutex> lock(current_node->node_mutex);
+void Mcts_agent::backpropagate(const std::vector<std::pair<NodeIndex, EdgeIndex>>& path, float value) {
+    // Start backpropagation. Follow the selection path rather than parent links:
+    // in the graph a node may have been reached through any of its parents
+    Cell_state leaf_player = path.empty() ? tree[root].player : tree[edges.child(path.back().second)].player;
+    for (auto step = path.rbegin(); step != path.rend(); ++step) {
+        const auto [parent, edge] = *step;
+
+        // Edges hold values from the point of view of the player choosing them
+        float signed_value = value;
+        if (tree[parent].player != leaf_player) {
+            signed_value = -value;
+        }
+        // Add the outcome and revert the virtual loss of this simulation
+        edges.add(edge, 1 - virtual_loss, signed_value + virtual_loss);
+        tree[edges.child(edge)].visit_count.fetch_add(1 - virtual_loss, std::memory_order_relaxed);
 
-        if (current_node->parent_node != nullptr && current_node->parent_node->player != root->player) {
-            current_node->acc_value -= value;
-        } else {
-            current_node->acc_value += value;
+        if constexpr (log_compiled(LogLevel::BACKPROP_ONLY)) {
+            logger->log_backpropagation_result(edge_move(edge), edges.value_sum(edge), edges.visit_count(edge));
         }
-        // Increment the node's visit count
-        current_node->visit_count += 1;
-        // Update accumulated value of the node
-        current_node->value_from_mcts = current_node->acc_value / current_node->visit_count;
+    }
+    // The root has no incoming edge and never receives a virtual loss
+    tree[root].visit_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Mcts_agent::propagate_proof(const std::vector<std::pair<NodeIndex, EdgeIndex>>& path) {
+    for (auto step = path.rbegin(); step != path.rend(); ++step) {
+        const auto [parent, edge] = *step;
+        const Node& child = tree[edges.child(edge)];
+        Proof child_proof = child.proof.load(std::memory_order_relaxed);
+        if (child_proof == Proof::Unknown) {
+            return;
+        }
+
+        // After a capture the same player moves again, otherwise the outcome flips
+        bool win_for_parent = (child_proof == Proof::Win) == (child.player == tree[parent].player);
+        edges.mark_proven(edge, win_for_parent);
 
-        logger->log_backpropagation_result(current_node->move, 
-                                    current_node->acc_value,
-                                    current_node->visit_count);
+        Node& parent_node = tree[parent];
+        if (win_for_parent) {
+            // One winning move is enough
+            parent_node.proof.store(Proof::Win, std::memory_order_relaxed);
+            continue;
+        }
 
-        // Move to the parent node for the next loop
-        current_node = current_node->parent_node;
+        // A loss only if every move is a proven loss
+        for (EdgeIndex sibling = parent_node.first_edge; sibling < parent_node.first_edge + parent_node.num_edges;
+             ++sibling) {
+            NodeIndex sibling_child = edges.child(sibling);
+            if (sibling_child == kNullNode) {
+                return;
+            }
+            const Node& sibling_node = tree[sibling_child];
+            Proof sibling_proof = sibling_node.proof.load(std::memory_order_relaxed);
+            bool loss_for_parent =
+                sibling_proof != Proof::Unknown &&
+                (sibling_proof == Proof::Win) != (sibling_node.player == parent_node.player);
+            if (!loss_for_parent) {
+                return;
+            }
+        }
+        parent_node.proof.store(Proof::Loss, std::memory_order_relaxed);
     }
 }
 
-std::shared_ptr<Mcts_agent::Node> Mcts_agent::select_best_child(std::shared_ptr<Node>& node) {
+EdgeIndex Mcts_agent::select_best_child(NodeIndex node, bool by_visits) const {
     double max_win_ratio = -1.;
-    std::shared_ptr<Node> best_child;
+    EdgeIndex best_child = kNullEdge;
 
-    for (const auto& child : node->child_nodes) {
-        double win_ratio = static_cast<double>(child->acc_value) / child->visit_count;
+    const Node& parent = tree[node];
+    for (EdgeIndex edge = parent.first_edge; edge < parent.first_edge + parent.num_edges; ++edge) {
+        if (edges.visit_count(edge) == 0) {
+            continue;
+        }
+        // Proven wins average to +inf and proven losses to -inf; a lost position still returns a move
+        double win_ratio = static_cast<double>(edges.value_sum(edge)) / edges.visit_count(edge);
 
-        if (win_ratio > max_win_ratio) {
+        if (best_child == kNullEdge || better_move(edges.visit_count(edge), win_ratio,
+                                                   edges.visit_count(best_child), max_win_ratio, by_visits)) {
             max_win_ratio = win_ratio;
-            best_child = child;
+            best_child = edge;
         }
     }
-    if (!best_child) {
+    if (best_child == kNullEdge) {
         throw std::runtime_error(
             "Statistics are not enough to determine a move. The AI had insufficient time for the given board size.");
     }
@@ -1,29 +1,149 @@
 #ifndef MCTS_AGENT_H
 #define MCTS_AGENT_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <random>
+#include <span>
+#include <thread>
 #include <vector>
 
 #include "board.h"
 #include "nn_model.h"
 #include "logger.h"
+#include "edge_arena.h"
+#include "eval_cache.h"
+#include "node_arena.h"
+#include "rng.h"
+#include "transposition_table.h"
+
+class EvalScheduler;
+class SearchTask;
+class NeuralN;
+
+/**
+ * @brief Input and output rows for NeuralN::evaluate
+ *
+ * Positions are written straight into the input rows (Board::write_planes,
+ * Board::write_legal_mask) and results are read straight from the output
+ * rows, which stay valid until the next evaluation with these buffers. The
+ * host tensors are page-locked when the network runs on CUDA so that the
+ * transfers are asynchronous copies.
+ */
+class InferenceBuffers {
+public:
+    float* input(std::size_t row) { return input_data + row * Board::input_size; }
+    float* legal_mask(std::size_t row) { return mask_data + row * Board::policy_size; }
+
+    /**
+     * @brief Policy log-probabilities of a row
+     */
+    std::span<const float> policy(std::size_t row) const {
+        return {policy_data + row * Board::policy_size, static_cast<std::size_t>(Board::policy_size)};
+    }
+
+    float value(std::size_t row) const { return value_data[row]; }
+
+    /**
+     * @brief Number of rows
+     */
+    std::size_t capacity() const { return rows; }
+
+private:
+    friend class NeuralN;
+
+    torch::Tensor input_tensor;
+    torch::Tensor mask_tensor;
+    torch::Tensor policy_tensor;
+    torch::Tensor value_tensor;
+    // Copies of the inputs on the device, undefined on CPU
+    torch::Tensor device_input;
+    torch::Tensor device_mask;
+    float* input_data = nullptr;
+    float* mask_data = nullptr;
+    float* policy_data = nullptr;
+    float* value_data = nullptr;
+    std::size_t rows = 0;
+};
+
+/**
+ * @brief Buffers checked out of the pool of a NeuralN, returned to it when the lease ends
+ *
+ * The network must outlive its leases.
+ */
+class BufferLease {
+public:
+    BufferLease(BufferLease&& other) noexcept : network(other.network), leased(other.leased) {
+        other.leased = nullptr;
+    }
+    BufferLease(const BufferLease&) = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
+    BufferLease& operator=(BufferLease&&) = delete;
+    ~BufferLease();
+
+    InferenceBuffers& operator*() const { return *leased; }
+    InferenceBuffers* operator->() const { return leased; }
+
+private:
+    friend class NeuralN;
+
+    BufferLease(NeuralN& network, InferenceBuffers& buffers) : network(&network), leased(&buffers) {}
+
+    NeuralN* network;
+    InferenceBuffers* leased;
+};
 
 /**
  * @brief Neural network wrapper for AlphaZero-style policy and value prediction
  *
  * Provides an interface to the neural network model for MCTS guidance.
+ * Searches evaluate through buffers and evaluate, which reuse the same
+ * memory on every call: buffers come from a pool that only grows when every
+ * buffer is checked out, so it holds one buffer per evaluation running at
+ * the same time, whatever the number of threads created over time. Once the
+ * pool has reached its largest batch, an evaluation allocates nothing
+ * outside the forward pass.
  */
 class NeuralN {
 public:
     /**
      * @brief Constructs a neural network wrapper
      *
+     * Loads the model and builds its fused inference copy (FusedAlphaZeroNet),
+     * which predict and evaluate run.
+     *
      * @param model_path Path to the saved model file
      * @param device Torch device to run inference on (CPU or CUDA)
+     * @param max_batch Rows allocated up front in each buffer of the pool
      */
-    NeuralN(const std::string& model_path, torch::Device device = torch::kCPU);
+    NeuralN(const std::string& model_path, torch::Device device = torch::kCPU, std::size_t max_batch = 1);
+
+    virtual ~NeuralN() = default;
+
+    /**
+     * @brief Checks buffers holding at least batch rows out of the pool
+     *
+     * A free buffer is reused (and grown if the batch is larger than its
+     * rows); a new one is created only when all are in use. The buffers are
+     * the caller's until the lease is destroyed.
+     *
+     * @param batch Number of positions about to be evaluated
+     */
+    BufferLease buffers(std::size_t batch);
+
+    /**
+     * @brief Evaluates the first batch rows of buffers in inference mode
+     *
+     * Virtual so that tests can substitute a network whose forward pass fails.
+     *
+     * @param buffers Leased buffers, with their input rows written
+     * @param batch Number of positions
+     */
+    virtual void evaluate(InferenceBuffers& buffers, std::size_t batch);
 
     /**
      * @brief Predicts policy and value for a given board state
@@ -35,17 +155,279 @@ public:
      */
     std::pair<torch::Tensor, torch::Tensor> predict(torch::Tensor input, torch::Tensor legal_mask);
 
+    /**
+     * @brief Switches CPU inference to INT8 after calibrating on stored positions
+     *
+     * See FusedAlphaZeroNet::calibrate_int8. Must not be called while predict runs.
+     *
+     * @param positions Dataset whose positions are used for the calibration
+     * @param max_policy_kl Largest mean policy KL divergence from fp32 accepted
+     * @param max_positions Number of positions used, at most
+     *
+     * @return Layers switched to INT8 and accuracy against fp32
+     *
+     * @throws std::runtime_error if the dataset is empty or the network is not on a supported CPU
+     */
+    QuantizationReport enable_int8(const GameDataset& positions, double max_policy_kl = 0.01,
+                                   std::size_t max_positions = 1024);
+
+    /**
+     * @brief Runs inference in fp32 again
+     */
+    void disable_int8();
+
+    /**
+     * @brief Runs predict on CpuInferenceEngine instead of libtorch
+     *
+     * The engine gets the fp32 folded weights, so INT8 layers are not used
+     * while it is enabled. Must not be called while predict runs.
+     *
+     * @throws std::runtime_error if the network is not on the CPU
+     */
+    void enable_cpu_engine();
+
+    /**
+     * @brief Runs predict on libtorch again
+     */
+    void disable_cpu_engine();
+
+    /**
+     * @brief Identifies the evaluations the network currently produces
+     *
+     * Unique to this network and its inference mode: switching INT8 or the
+     * built-in engine on or off gives a new generation, so the EvalCache
+     * entries of the previous mode are no longer returned.
+     */
+    std::uint64_t generation() const { return generation_id; }
+
 private:
+    friend class BufferLease;
+
     torch::nn::ModuleHolder<AlphaZeroNetWithMaskImpl> model;
     torch::Device device;
+    std::unique_ptr<FusedAlphaZeroNet> inference_net;
+    std::unique_ptr<CpuInferenceEngine> cpu_engine;
+    std::uint64_t generation_id;
+    std::size_t max_batch;
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<InferenceBuffers>> buffer_pool;
+    std::vector<InferenceBuffers*> free_buffers;
+
+    void allocate(InferenceBuffers& buffers, std::size_t rows) const;
+
+    /**
+     * @brief Puts leased buffers back in the pool
+     */
+    void release(InferenceBuffers& buffers);
+};
+
+/**
+ * @brief How an agent uses several search threads
+ */
+enum class ParallelMode {
+    /**
+     * @brief All threads share one tree (virtual loss keeps them apart)
+     */
+    Tree,
+
+    /**
+     * @brief Each thread grows its own tree with its own root noise; root visits are merged
+     */
+    Root
+};
+
+/**
+ * @brief What the search does once its tree reaches the memory cap
+ */
+enum class TreeMemoryPolicy {
+    /**
+     * @brief Stop creating nodes and keep refining the statistics of the existing tree
+     */
+    Refine,
+
+    /**
+     * @brief Drop the least visited subtrees and keep expanding in the room freed
+     */
+    Recycle
+};
+
+/**
+ * @brief Limits and settings of a single MCTS search
+ *
+ * The search stops as soon as any enabled limit is reached. A limit set to 0
+ * is disabled.
+ */
+struct SearchBudget {
+    /**
+     * @brief Maximum number of simulations
+     */
+    int max_iterations = 0;
+
+    /**
+     * @brief Wall-clock budget of the search
+     */
+    std::chrono::milliseconds max_time{0};
+
+    /**
+     * @brief Maximum number of tree nodes
+     */
+    std::size_t max_nodes = 0;
+
+    /**
+     * @brief Stop once the most visited root child cannot be overtaken
+     *
+     * With an iteration or time limit, the search ends when the visit lead of
+     * the best root child exceeds the number of simulations that can still
+     * run. A forced move (single legal move) ends the search after one
+     * simulation. The move played is then the most visited root child
+     * rather than the one with the best mean value, so stopping early never
+     * changes it.
+     */
+    bool early_stop = true;
+
+    /**
+     * @brief Mix Dirichlet noise into the root priors (disabled for cheap self-play searches)
+     */
+    bool root_noise = true;
+
+    /**
+     * @brief Gumbel-Top-k root with sequential halving instead of noisy PUCT at the root
+     *
+     * Meant for small iteration budgets (16-64 simulations): the root
+     * samples gumbel_actions moves without replacement using Gumbel noise on
+     * the prior logits, then splits max_iterations between them in rounds,
+     * halving the candidates after each round. Needs an iteration limit;
+     * the policy target becomes the improved policy softmax(logits + sigma(q)).
+     */
+    bool gumbel_root = false;
+
+    /**
+     * @brief Number of root moves considered by the Gumbel root
+     */
+    int gumbel_actions = 16;
+};
+
+/**
+ * @brief Performance figures of the last search of an agent
+ *
+ * Filled at the end of every search so throughput can be tracked without
+ * parsing the logs. Times are summed over all search threads, so with
+ * several threads the phase times may exceed elapsed_seconds.
+ */
+struct SearchStats {
+    /**
+     * @brief Simulations completed
+     */
+    int simulations = 0;
+
+    /**
+     * @brief Wall-clock duration of the search, including the root expansion
+     */
+    double elapsed_seconds = 0.0;
+
+    /**
+     * @brief Simulations per second of wall-clock time
+     */
+    double simulations_per_second = 0.0;
+
+    /**
+     * @brief Positions evaluated by the network (cache misses)
+     */
+    std::size_t nn_evaluations = 0;
+
+    /**
+     * @brief Positions answered by the evaluation cache
+     */
+    std::size_t cache_hits = 0;
+
+    /**
+     * @brief Mean and maximum number of edges between the root and the selected leaf
+     */
+    double average_depth = 0.0;
+    int max_depth = 0;
+
+    /**
+     * @brief Nodes in the tree at the end of the search and memory used by nodes and edges
+     */
+    std::size_t node_count = 0;
+    std::size_t tree_bytes = 0;
+
+    /**
+     * @brief Nodes dropped by tree recycling when the memory cap was reached
+     */
+    std::size_t recycled_nodes = 0;
+
+    /**
+     * @brief Simulations that found the node or edge arena full and could not grow the tree
+     */
+    std::size_t arena_full = 0;
+
+    /**
+     * @brief Time spent selecting leaves, writing expansions, in the network and backing up values
+     */
+    double selection_seconds = 0.0;
+    double expansion_seconds = 0.0;
+    double nn_seconds = 0.0;
+    double backup_seconds = 0.0;
+
+    /**
+     * @brief Mean fill of the forward passes that evaluated the positions of this search
+     *
+     * Each evaluation counts the size of its batch over the largest batch of
+     * the path that ran it: the batch of the stepwise driver or of the
+     * EvalScheduler, or 1 for the blocking search, which evaluates one
+     * position per call.
+     */
+    double batch_fill_ratio = 0.0;
+};
+
+/**
+ * @brief Network input of a leaf waiting for its evaluation in a stepwise search
+ */
+struct EvaluationRequest {
+    /**
+     * @brief Board planes of the leaf for its player to move (see Board::write_planes)
+     */
+    std::array<float, Board::input_size> input;
+
+    /**
+     * @brief Legal moves of the leaf (see Board::write_legal_mask)
+     */
+    std::array<float, Board::policy_size> legal_mask;
+
+    /**
+     * @brief Writes the network input of a position
+     */
+    void fill(const Board& board, Cell_state player) {
+        board.write_planes(player, input.data());
+        board.write_legal_mask(player, legal_mask.data());
+    }
 };
 
 /**
  * @brief Implements a Monte Carlo Tree Search (MCTS) agent for decision-making in games
  *
  * Simulates gameplay guided by a neural network to determine the best move within
- * a fixed number of iterations. Balances exploration and exploitation using the
- * PUCT formula with neural network priors. Supports optional logging.
+ * a budget of iterations, time or tree nodes (see SearchBudget). Balances exploration and exploitation using the
+ * PUCT formula with neural network priors. Simulations can run on several
+ * threads sharing one tree: node statistics are lock-free atomics and virtual
+ * loss steers concurrent selections apart. Positions reached by different
+ * move orders share one node through a transposition table, so the search
+ * runs on a directed graph rather than a tree. Proven wins and losses are
+ * propagated minimax-style (MCTS-solver): solved nodes are no longer searched
+ * and the search ends as soon as the root is solved. Alternatively, in root-parallel
+ * mode, each thread runs an independent search and only the root statistics
+ * are merged. Supports optional logging.
+ *
+ * With pondering enabled the agent keeps its tree between moves: after
+ * choosing a move it keeps searching in a background thread while the
+ * opponent thinks, and the next search starts from the subtree matching the
+ * position actually reached.
+ *
+ * The tree lives in arenas allocated once, so its memory never exceeds the
+ * capacity chosen at construction (from the iterations, or from an explicit
+ * byte cap). When the arenas are full the search either stops expanding and
+ * only refines, or recycles the least visited subtrees to make room.
  *
  * @note Assumes a `Board` class with `get_valid_moves()`, `make_move()`, and
  *       `check_winner()` methods, and a `Cell_state` enum with `Empty`, `X`, and `O`.
@@ -59,10 +441,47 @@ public:
      * @param exploration_factor The constant controlling exploration vs exploitation in the PUCT formula
      * @param number_iteration Maximum number of MCTS simulations to perform
      * @param log_level The level of log that we need (0 to 6)
+     * @param num_threads Number of threads running simulations on the shared tree
+     * @param ponder Keep searching during the opponent's turn and reuse the tree between moves
+     *               (ignored in root-parallel mode)
+     * @param parallel_mode Share one tree between the threads or run one independent search per thread
+     * @param max_tree_bytes Memory cap of the search tree, 0 to size it from number_iteration
+     * @param memory_policy Refine only or recycle subtrees once the tree is full
      */
     Mcts_agent(double exploration_factor,
                int number_iteration,
-               LogLevel log_level = LogLevel::NONE);
+               LogLevel log_level = LogLevel::NONE,
+               int num_threads = 1,
+               bool ponder = false,
+               ParallelMode parallel_mode = ParallelMode::Tree,
+               std::size_t max_tree_bytes = 0,
+               TreeMemoryPolicy memory_policy = TreeMemoryPolicy::Refine);
+
+    /**
+     * @brief Constructs an agent evaluating positions with an already loaded network
+     *
+     * Lets several agents share one network, e.g. the games of a batched self-play driver.
+     *
+     * @param network Network evaluating the positions
+     * @see Mcts_agent(double, int, LogLevel, int, bool, ParallelMode, std::size_t, TreeMemoryPolicy)
+     */
+    Mcts_agent(std::shared_ptr<NeuralN> network,
+               double exploration_factor,
+               int number_iteration,
+               LogLevel log_level = LogLevel::NONE,
+               int num_threads = 1,
+               bool ponder = false,
+               ParallelMode parallel_mode = ParallelMode::Tree,
+               std::size_t max_tree_bytes = 0,
+               TreeMemoryPolicy memory_policy = TreeMemoryPolicy::Refine);
+
+    /**
+     * @brief Stops the background search, if any
+     */
+    ~Mcts_agent();
+
+    Mcts_agent(const Mcts_agent&) = delete;
+    Mcts_agent& operator=(const Mcts_agent&) = delete;
 
     /**
      * @brief Selects the best move using Monte Carlo Tree Search (MCTS)
@@ -83,6 +502,32 @@ public:
      */
     std::pair<std::array<int, 4>, torch::Tensor> choose_move(const Board& board, Cell_state player);
 
+    /**
+     * @brief Selects the best move with an explicit search budget
+     *
+     * Anytime version of choose_move: the search runs until the first limit of
+     * the budget is reached, or earlier when the decision can no longer change.
+     *
+     * When pondering, the background search is stopped first and, if the
+     * position is found in the pondered tree, that subtree is kept as the new
+     * root. Once the move is chosen the agent starts pondering on the
+     * position it leads to.
+     *
+     * In root-parallel mode the iteration and node limits are split between
+     * the independent searches, and the visit counts and values of their root
+     * children are summed move by move before choosing.
+     *
+     * @param board Current game state
+     * @param player The player making the move
+     * @param budget Iteration, time and node limits of this search
+     *
+     * @return Pair containing the best move as std::array<int, 4> and policy tensor
+     *
+     * @throws runtime_error If insufficient simulations prevent a reliable decision
+     */
+    std::pair<std::array<int, 4>, torch::Tensor> choose_move(const Board& board, Cell_state player,
+                                                             const SearchBudget& budget);
+
     /**
      * @brief Executes random moves on the board for exploration
      *
@@ -95,14 +540,144 @@ public:
      */
     void random_move(Board& board, Cell_state player, int random_move_number);
 
+    /**
+     * @brief Stops the background search started after the last move, if any
+     *
+     * The pondered tree is kept for the next call to choose_move.
+     */
+    void stop_pondering();
+
+    /**
+     * @brief Performance figures of the last call to choose_move
+     */
+    const SearchStats& last_search_stats() const { return last_stats; }
+
+    /**
+     * @brief Writes the search tree to a binary dump (see tree_dump.h)
+     *
+     * Dumps every node and edge of the arenas with their statistics, in two
+     * bulk writes. In root-parallel mode the tree of the first independent
+     * search is written. Must not be called while a search or pondering runs.
+     *
+     * @param path File to create
+     *
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void export_tree(const std::string& path) const;
+
+    /**
+     * @brief Dumps the tree of every following choose_move call, right after its search
+     *
+     * The dump is taken before pondering reshapes the tree. Each move
+     * overwrites the file of the previous one.
+     *
+     * @param path File receiving the dumps, empty to stop dumping
+     */
+    void set_tree_export(std::string path) { tree_export_path = std::move(path); }
+
+    /**
+     * @brief Starts a search driven step by step by the caller
+     *
+     * The stepwise search runs on the caller's thread and never calls the
+     * network itself: advance_search hands out the leaf that needs an
+     * evaluation and provide_evaluation resumes the simulation with the
+     * result, so a driver can gather the leaves of many agents into one
+     * batched forward pass. Pondering and the Gumbel root are not used.
+     *
+     * @param board Current game state
+     * @param player The player making the move
+     * @param budget Iteration, time and node limits of this search
+     */
+    void start_search(const Board& board, Cell_state player, const SearchBudget& budget);
+
+    /**
+     * @brief Runs simulations until one needs the network or the budget is spent
+     *
+     * Leaves found in the evaluation cache, terminal and proven leaves are
+     * resolved on the spot.
+     *
+     * @param request Receives the network input of the leaf to evaluate
+     *
+     * @return True if request was filled and provide_evaluation must be called, false once the search is over
+     */
+    bool advance_search(EvaluationRequest& request);
+
+    /**
+     * @brief Resumes the simulation stopped by advance_search with the network output
+     *
+     * @param policy Log-probabilities of the requested leaf (one row of a batched forward pass)
+     * @param value Value of the requested leaf for its player to move
+     * @param batch_size Positions of the forward pass that evaluated the leaf
+     * @param batch_capacity Largest batch the caller runs
+     */
+    void provide_evaluation(std::span<const float> policy, float value, std::size_t batch_size = 1,
+                            std::size_t batch_capacity = 1);
+
+    /**
+     * @brief Ends a stepwise search and chooses the most promising root move
+     *
+     * @return Pair containing the best move as std::array<int, 4> and policy tensor
+     *
+     * @throws runtime_error If no root child was visited
+     */
+    std::pair<std::array<int, 4>, torch::Tensor> finish_search();
+
+    /**
+     * @brief Starts a search whose simulations run as coroutines on a scheduler
+     *
+     * Instead of blocking on the network, each simulation co_awaits its leaf
+     * evaluation, so the scheduler can interleave the simulations of many
+     * trees on a few threads and evaluate their leaves in shared batches.
+     * The root is expanded first, then in_flight simulation loops share the
+     * tree (virtual loss spreads them). Call finish_search once
+     * EvalScheduler::run has returned. Pondering and the Gumbel root are not used.
+     *
+     * @param scheduler Scheduler running the simulations
+     * @param board Current game state
+     * @param player The player making the move
+     * @param budget Iteration, time and node limits of this search
+     * @param in_flight Simulations of this tree waiting for the network at the same time
+     */
+    void spawn_search(EvalScheduler& scheduler, const Board& board, Cell_state player, const SearchBudget& budget,
+                      int in_flight = 8);
+
+    /**
+     * @brief Converts the network policy of a position into (move index, prior) pairs of its legal moves
+     *
+     * Reads the log-probabilities in place (one row of the network output
+     * buffers) and keeps the moves with a non-zero probability.
+     *
+     * @param policy Log-probabilities of the Board::policy_size moves
+     *
+     * @return Normalized priors of the moves with a non-zero probability
+     */
+    static std::vector<std::pair<std::uint16_t, float>> sparse_policy(std::span<const float> policy);
+
 private:
     std::shared_ptr<NeuralN> agent;
     double exploration_factor;
     int number_iteration;
+    int num_threads;
+    int virtual_loss;
     LogLevel log_level;
     std::shared_ptr<Logger> logger;
-    std::random_device random_device;
-    std::mt19937 random_generator;
+    std::shared_ptr<EvalCache> eval_cache;
+    Xoshiro256 random_generator;
+    bool ponder;
+    ParallelMode parallel_mode;
+    std::size_t max_tree_bytes;
+    TreeMemoryPolicy memory_policy;
+    std::string tree_export_path;
+
+    /**
+     * @brief Expansion progress of a node, used to hand the expansion to a single thread
+     */
+    enum class ExpansionState : std::uint8_t { Unexpanded, Expanding, Expanded };
+
+    /**
+     * @brief Game-theoretic outcome of a node for the player to move, once proven
+     */
+    enum class Proof : std::uint8_t { Unknown, Win, Loss };
 
     /**
      * @brief Represents a node in the Monte Carlo Tree Search (MCTS) tree
@@ -111,83 +686,411 @@ private:
      * information and statistics accumulated during the search process.
      */
     struct Node {
+        /**
+         * @brief Hash of the position (Board::hash), key in the transposition table
+         */
+        std::uint64_t key;
+
         /**
          * @brief Value estimate from the neural network evaluation
          */
         float value_from_nn;
 
         /**
-         * @brief Mean action value from MCTS simulations (Q-value)
+         * @brief Whether the node is unexpanded, being expanded by a thread, or expanded
+         *
+         * Switching to Expanded publishes first_edge, num_edges and value_from_nn.
+         */
+        std::atomic<ExpansionState> expansion_state;
+
+        /**
+         * @brief Proven outcome: terminal positions, or minimax over proven children
          */
-        float value_from_mcts;
+        std::atomic<Proof> proof;
 
         /**
-         * @brief Flag indicating if the node has been expanded with neural network evaluation
+         * @brief Number of times this node has been visited during search
+         *
+         * Includes the pending virtual visits of in-flight simulations.
          */
-        bool expanded;
+        std::atomic<int> visit_count;
 
         /**
-         * @brief Accumulated value from all simulations passing through this node
+         * @brief Player that will make the move from this state
          */
-        float acc_value;
+        Cell_state player;
 
         /**
-         * @brief Prior policy probability from the neural network
+         * @brief Index of the first outgoing edge (the edges of a node are contiguous)
+         *
+         * Priors, visit counts and value sums of the children live in the edges.
          */
-        float prior_proba;
+        EdgeIndex first_edge;
 
         /**
-         * @brief Number of times this node has been visited during search
+         * @brief Number of outgoing edges, one per legal move
          */
-        int visit_count;
+        std::uint32_t num_edges;
 
         /**
-         * @brief Move that led to this state from parent (array format: {x, y, direction, target})
+         * @brief Index of the parent that first reached this node (kNullNode for root)
          *
-         * For root node, uses sentinel value {-1, -1, -1, -1}
+         * Other parents may share the node through transpositions; backpropagation
+         * follows the selection path instead.
          */
-        std::array<int, 4> move;
+        NodeIndex parent_node;
 
         /**
-         * @brief Player that will make the move from this state
+         * @brief Edge of that parent leading to this node (kNullEdge for root)
          */
-        Cell_state player;
+        EdgeIndex parent_edge;
+
+        /**
+         * @brief Reinitialize an arena slot as a new MCTS tree node
+         *
+         * @param player Player making the move from this state
+         * @param key Hash of this state
+         * @param value_from_nn Value estimate of this state from neural network
+         * @param parent_node Parent node index (kNullNode for root)
+         * @param parent_edge Edge of the parent leading to this state (kNullEdge for root)
+         */
+        void reset(Cell_state player, std::uint64_t key, float value_from_nn,
+                   NodeIndex parent_node = kNullNode, EdgeIndex parent_edge = kNullEdge);
 
         /**
-         * @brief Child nodes representing states reachable by one move
+         * @brief Check whether the expansion of this node has been published
          */
-        std::vector<std::shared_ptr<Node>> child_nodes;
+        bool expanded() const {
+            return expansion_state.load(std::memory_order_acquire) == ExpansionState::Expanded;
+        }
+    };
+
+    /**
+     * @brief Upper bound on edges created by one expansion, used to size the edge arena
+     */
+    static constexpr std::size_t edges_per_iteration = 64;
+
+    NodeArena<Node> tree;
+    EdgeArena edges;
+    NodeIndex root;
+
+    /**
+     * @brief Node of every position in the arena, so transpositions share one node
+     */
+    TranspositionTable transpositions;
+
+    /**
+     * @brief Arenas receiving the kept subtree during compaction (empty without pondering or recycling)
+     */
+    NodeArena<Node> spare_tree;
+    EdgeArena spare_edges;
+
+    /**
+     * @brief Position of the root while the tree is kept between moves
+     */
+    std::optional<Board> root_board;
+
+    std::thread ponder_thread;
+
+    /**
+     * @brief Asks running simulations loops to stop, used to end pondering
+     */
+    std::atomic<bool> stop_requested;
+
+    /**
+     * @brief Independent single-threaded searches of root-parallel mode (empty otherwise)
+     *
+     * They share the network of this agent but each has its own tree and random generator.
+     */
+    std::vector<std::unique_ptr<Mcts_agent>> ensemble;
+
+    /**
+     * @brief Raw counters of the running search, updated by every search thread
+     */
+    struct SearchCounters {
+        std::atomic<std::uint64_t> nn_evaluations{0};
+        std::atomic<std::uint64_t> batch_rows{0};   // Sum over evaluations of their batch size
+        std::atomic<std::uint64_t> batch_slots{0};  // Sum over evaluations of their batch capacity
+        std::atomic<std::uint64_t> cache_hits{0};
+        std::atomic<std::uint64_t> depth_sum{0};
+        std::atomic<int> max_depth{0};
+        std::atomic<std::int64_t> selection_ns{0};
+        std::atomic<std::int64_t> expansion_ns{0};
+        std::atomic<std::int64_t> nn_ns{0};
+        std::atomic<std::int64_t> backup_ns{0};
+        std::atomic<std::uint64_t> recycled_nodes{0};
+        std::atomic<std::uint64_t> arena_full{0};
+
+        void reset();
+    };
+
+    SearchCounters counters;
+    SearchStats last_stats;
+
+    /**
+     * @brief Turns the counters of the search that just ended into last_stats
+     *
+     * @param simulations Simulations completed
+     * @param start Time at which the search started
+     */
+    void finish_search_stats(int simulations, std::chrono::steady_clock::time_point start);
+
+    /**
+     * @brief State of a search driven through start_search, advance_search and provide_evaluation
+     */
+    struct StepwiseSearch {
+        SearchBudget budget;
+        std::chrono::steady_clock::time_point start;
+        std::atomic<int> completed = 0;
+        bool root_noise = false;
+        Board board;
 
         /**
-         * @brief Pointer to parent node (nullptr for root)
+         * @brief Virtual loss to restore once a coroutine search is finished (-1 if unchanged)
          */
-        std::shared_ptr<Node> parent_node;
+        int restore_virtual_loss = -1;
 
         /**
-         * @brief Mutex for thread-safe node updates during parallel MCTS
+         * @brief Leaf waiting for its evaluation, its position hash and the path leading to it
          */
-        std::mutex node_mutex;
+        NodeIndex leaf = kNullNode;
+        std::uint64_t leaf_key = 0;
+        std::vector<std::pair<NodeIndex, EdgeIndex>> path;
 
         /**
-         * @brief Create a new MCTS tree node
-         *
-         * @param player Player making the move from this state
-         * @param move Move array {x, y, direction, target} leading to this state
-         * @param prior_proba Prior probability of the move leading to this sate from neural network policy
-         * @param value_from_nn Value estimate of this state from neural network
-         * @param parent_node Parent node pointer (nullptr for root)
+         * @brief Simulations started by the coroutines of a coroutine search, including the running ones
          */
-        Node(Cell_state player, std::array<int, 4> move, float prior_proba, 
-             float value_from_nn, std::shared_ptr<Node> parent_node = nullptr);
+        std::atomic<int> next_iteration = 0;
     };
 
-    std::shared_ptr<Node> root;
+    std::optional<StepwiseSearch> stepwise;
+
+    /**
+     * @brief Records the depth of a selection path in the search counters
+     */
+    void record_depth(int depth);
+
+    /**
+     * @brief Records one network evaluation and the batch that ran it in the search counters
+     */
+    void record_evaluation(std::size_t batch_size, std::size_t batch_capacity);
+
+    /**
+     * @brief Coroutine expanding the root of a coroutine search, then spawning its simulation loops
+     */
+    SearchTask expand_root_task(EvalScheduler& scheduler, int in_flight);
+
+    /**
+     * @brief Coroutine running simulations until the budget of the search is spent
+     *
+     * Suspends on the network evaluation of each new leaf, and on the next
+     * batch when the leaf is being evaluated by another simulation.
+     */
+    SearchTask simulation_task(EvalScheduler& scheduler);
+
+    /**
+     * @brief Move chosen by the Gumbel root during the last search (kNullEdge otherwise)
+     */
+    EdgeIndex gumbel_choice;
+
+    /**
+     * @brief Visit offset of the Gumbel value transform sigma(q) = (c_visit + max N) * c_scale * q
+     */
+    static constexpr float gumbel_c_visit = 50.0f;
+
+    /**
+     * @brief Scale of the Gumbel value transform
+     */
+    static constexpr float gumbel_c_scale = 1.0f;
+
+    /**
+     * @brief Runs the search with a Gumbel-Top-k root and sequential halving
+     *
+     * Sets gumbel_choice to the surviving move with the best
+     * g(a) + logit(a) + sigma(q(a)). Unless the time runs out or the root
+     * is proven, exactly max_iterations simulations run: the rounding
+     * leftover goes to the surviving move.
+     *
+     * @param budget Limits of the search, max_iterations must be set
+     * @param board Position of the root
+     *
+     * @return Number of simulations performed
+     */
+    int run_gumbel_root(const SearchBudget& budget, const Board& board);
+
+    /**
+     * @brief Gumbel value transform of a root edge, from its normalized mean value
+     *
+     * @param edge Root edge
+     * @param max_visits Highest visit count among the root edges
+     *
+     * @return sigma(q) of the edge, 0 when unvisited
+     */
+    float gumbel_sigma(EdgeIndex edge, std::int32_t max_visits) const;
+
+    /**
+     * @brief Improved policy softmax(logits + sigma(completed q)) over the root moves
+     *
+     * Unvisited moves are completed with the mixed value of the root
+     * (network value and prior-weighted mean of the visited moves).
+     *
+     * @return 1D tensor of size (X * Y * DIR * TAR) with the improved policy
+     */
+    torch::Tensor get_improved_policy() const;
+
+    /**
+     * @brief Number of nodes the arenas are sized for at construction
+     *
+     * From the byte cap when one is set, counting for each node a full
+     * expansion of edges and its transposition slots (twice when spare arenas
+     * are needed), otherwise from the iteration count; reserve_tree grows
+     * uncapped arenas to the budget of each search.
+     */
+    std::size_t node_capacity() const;
+
+    /**
+     * @brief Grows the arenas so that a search within the budget cannot run out of nodes
+     *
+     * Each simulation creates at most one node, on top of the kept tree. The
+     * number of simulations is the iteration limit, or for a time limit the
+     * rate of the previous search over the allotted time (with a margin),
+     * bounded by the node limit. Arenas under a byte cap keep their size. The
+     * kept tree, if any, is compacted into the new arenas.
+     *
+     * Must not run concurrently with simulations.
+     *
+     * @param budget Limits of the search about to start
+     */
+    void reserve_tree(const SearchBudget& budget);
+
+    /**
+     * @brief Builds (or reuses) the tree of a position and searches it within the budget
+     *
+     * @param board Current game state
+     * @param player The player making the move
+     * @param budget Iteration, time and node limits of this search
+     *
+     * @return Number of simulations performed
+     */
+    int search(const Board& board, Cell_state player, const SearchBudget& budget);
+
+    /**
+     * @brief Runs the ensemble searches in parallel and chooses from their merged root statistics
+     *
+     * @param board Current game state
+     * @param player The player making the move
+     * @param budget Limits shared by the whole ensemble
+     *
+     * @return Pair containing the best move and the merged visit policy
+     *
+     * @throws runtime_error If no root child was visited
+     */
+    std::pair<std::array<int, 4>, torch::Tensor> choose_move_root_parallel(const Board& board, Cell_state player,
+                                                                           const SearchBudget& budget);
+
+    /**
+     * @brief Moves the root to the child reached by the chosen move and searches it in the background
+     *
+     * @param board Position at the current root
+     * @param best_edge Edge of the move played from the root
+     */
+    void start_pondering(const Board& board, EdgeIndex best_edge);
+
+    /**
+     * @brief Looks for a kept node whose position is the given one
+     *
+     * The kept tree is fully indexed by the transposition table, so this is a
+     * single lookup of the position hash.
+     *
+     * @param board Position to find
+     * @param player Player to move in that position
+     *
+     * @return Matching expanded node, or kNullNode if the position is not in the tree
+     */
+    NodeIndex find_reusable_root(const Board& board, Cell_state player) const;
+
+    /**
+     * @brief Keeps only the subtree of a node and makes it the root
+     *
+     * Copies the subtree breadth-first into the spare arenas, so that it is
+     * contiguous again, then swaps them with the live ones. Nodes shared by
+     * several parents are copied once, and the transposition table is rebuilt
+     * for the kept nodes. The rest of the tree is released.
+     *
+     * Children with fewer than min_visits visits are dropped with their
+     * subtrees; their edges keep their statistics and a fresh child is created
+     * if the edge is selected again. Proven nodes are always kept.
+     *
+     * @param new_root Node becoming the root
+     * @param min_visits Visits a child needs to be kept, 0 to keep the whole subtree
+     */
+    void compact_tree(NodeIndex new_root, int min_visits = 0);
+
+    /**
+     * @brief Checks whether the arenas may not have room for one more expansion per thread
+     */
+    bool tree_nearly_full() const;
+
+    /**
+     * @brief Drops the least visited subtrees so that about half of the node arena is free again
+     *
+     * Must not run concurrently with simulations. The root keeps its edge
+     * range, so root edge indices held by the caller stay valid.
+     */
+    void recycle_tree();
+
+    /**
+     * @brief Mixes Dirichlet noise into the priors of the edges of a node
+     *
+     * @param node Expanded node, normally the root
+     * @param dirichlet_alpha Concentration parameter for Dirichlet distribution
+     * @param exploration_fraction Weight of noise vs network priors (0.0 - 1.0)
+     */
+    void apply_dirichlet_noise(NodeIndex node, float dirichlet_alpha, float exploration_fraction);
+
+    /**
+     * @brief Move leading to a node, {-1, -1, -1, -1} for the root
+     *
+     * @param node Node whose incoming move is requested
+     *
+     * @return Move array {x, y, direction, target}
+     */
+    std::array<int, 4> node_move(NodeIndex node) const;
+
+    /**
+     * @brief Move stored in an edge
+     *
+     * @param edge Edge whose move is requested
+     *
+     * @return Move array {x, y, direction, target}
+     */
+    std::array<int, 4> edge_move(EdgeIndex edge) const;
+
+    /**
+     * @brief Creates the child node of an edge on its first selection
+     *
+     * Expansion only records the moves and priors of a node; the child node
+     * is allocated here, the first time a simulation goes through the edge.
+     * If another thread materialized it concurrently, its node is returned.
+     * A position already in the transposition table reuses the existing node.
+     *
+     * @param parent_node Node owning the edge
+     * @param edge Edge whose child is needed
+     * @param child_key Hash of the position reached by the edge
+     *
+     * @return Child node of the edge, or kNullNode if the node arena is full
+     */
+    NodeIndex materialize_child(NodeIndex parent_node, EdgeIndex edge, std::uint64_t child_key);
 
     /**
      * @brief Initializes node and evaluates it with the neural network
      *
-     * Expands the given node by creating child nodes for all valid moves.
-     * Queries the neural network for policy priors and value estimate.
+     * Expands the given node by storing a compact (move, prior) edge for every
+     * valid move in one contiguous range. Child nodes are not created here but
+     * on first selection (see materialize_child). If the edge arena is full
+     * the node is evaluated but left without children.
+     * Takes the policy priors and value estimate from the process-wide
+     * EvalCache, and queries the neural network only on a miss.
      * Optionally adds Dirichlet noise to root node for exploration.
      *
      * @param node Node to initialize and expand
@@ -198,12 +1101,37 @@ private:
      *
      * @return Value estimate from neural network for this position
      */
-    float initiate_and_run_nn(const std::shared_ptr<Node>& node,
+    float initiate_and_run_nn(NodeIndex node,
                                const Board& board,
                                bool add_dirichlet_noise,
                                float dirichlet_alpha,
                                float exploration_fraction);
 
+    /**
+     * @brief Looks up the evaluation of a position in the EvalCache
+     *
+     * @param position_key Hash of the position for its player to move
+     * @param value Receives the cached value
+     * @param move_with_logit Receives the cached (move index, prior) pairs
+     *
+     * @return True on a hit
+     */
+    bool lookup_evaluation(std::uint64_t position_key, float& value,
+                           std::vector<std::pair<std::uint16_t, float>>& move_with_logit);
+
+    /**
+     * @brief Writes the edges and value of an evaluated node and publishes its expansion
+     *
+     * @param node Node being expanded (in the Expanding state)
+     * @param value Value of the node for its player to move
+     * @param move_with_logit (move index, prior) pair of every legal move
+     * @param add_dirichlet_noise Whether to add exploration noise to priors
+     * @param dirichlet_alpha Concentration parameter for Dirichlet distribution
+     * @param exploration_fraction Weight of noise vs network priors (0.0 - 1.0)
+     */
+    void expand_node(NodeIndex node, float value, const std::vector<std::pair<std::uint16_t, float>>& move_with_logit,
+                     bool add_dirichlet_noise, float dirichlet_alpha, float exploration_fraction);
+
     /**
      * @brief Generates Dirichlet noise for exploration at root node
      *
@@ -217,58 +1145,77 @@ private:
     /**
      * @brief Performs Monte Carlo Tree Search guided by neural network
      *
-     * Executes the main MCTS loop for a specified number of iterations.
-     * Each iteration selects, expands, simulates (via NN), and backpropagates.
+     * Executes the main MCTS loop until the budget is exhausted, spread over
+     * num_threads threads that share the tree. Each iteration selects,
+     * expands, simulates (via NN), and backpropagates.
      * Logs statistics according to verbose mode level
      *
-     * @param number_iteration Number of MCTS simulations to run
+     * @param budget Iteration, time and node limits of the search
      * @param mcts_iteration_counter Reference to iteration counter for logging
      * @param board Initial game state to search from
+     * @param root_schedule Root edge forced for each simulation, nullptr to select the root edge by PUCT
      */
-    void perform_mcts_iterations(const int number_iteration,
+    void perform_mcts_iterations(const SearchBudget& budget,
                                   int& mcts_iteration_counter,
-                                  const Board& board);
+                                  const Board& board,
+                                  const std::vector<EdgeIndex>* root_schedule = nullptr);
 
     /**
-     * @brief Computes policy logits tensor from MCTS visit counts
+     * @brief Checks whether the search must stop
      *
-     * Generates a tensor representing the search statistics for all
-     * possible moves. Each entry corresponds to the ratio of child visit count
-     * to parent visit count. Unexplored moves receive a value of 0.
+     * @param budget Limits of the current search
+     * @param completed Number of simulations completed so far
+     * @param start Time at which the search started
      *
-     * @param parent_node Node whose children are evaluated for policy extraction
+     * @return True if a limit is reached, a stop was requested or the best root child can no longer be overtaken
+     */
+    bool should_stop_search(const SearchBudget& budget, int completed,
+                            std::chrono::steady_clock::time_point start) const;
+
+    /**
+     * @brief Runs one selection, evaluation and backpropagation pass
      *
-     * @return 1D tensor of size (X * Y * DIR * TAR) with normalized visit count ratios
+     * @param iteration_number Index of the simulation, used for logging
+     * @param board Initial game state to search from
+     * @param forced_root_edge Root edge to take, kNullEdge to select it by PUCT
      */
-    torch::Tensor get_policy_logits(const std::shared_ptr<Node>& parent_node) const;
+    void run_simulation(int iteration_number, const Board& board, EdgeIndex forced_root_edge = kNullEdge);
 
     /**
-     * @brief Converts policy tensor into list of moves with probabilities
+     * @brief Computes policy logits tensor from MCTS visit counts
      *
-     * Extracts non-zero entries from the policy tensor and converts them into
-     * a list of move-probability pairs for easier processing.
+     * Generates a tensor representing the search statistics for all
+     * possible moves. Each entry corresponds to the ratio of child visit count
+     * to parent visit count. Unexplored moves receive a value of 0.
      *
-     * @param log_probs_tensor 1D tensor of log probabilities for all moves from NN
+     * @param parent_node Node whose children are evaluated for policy extraction
      *
-     * @return Vector of pairs: (move array {x, y, direction, target}, normalized probability)
+     * @return 1D tensor of size (X * Y * DIR * TAR) with normalized visit count ratios
      */
-    std::vector<std::pair<std::array<int, 4>, float>> get_moves_with_probs(
-        const torch::Tensor& log_probs_tensor) const;
+    torch::Tensor get_policy_logits(NodeIndex parent_node) const;
 
     /**
      * @brief Select a leaf by moving the tree using PUCT Score
      *
      * Evaluates all children of the parent node and selects the one with the
      * highest PUCT score, which balances exploitation (Q-value) and exploration
-     * (prior probability and visit counts). Updates the board state accordingly.
+     * (prior probability and visit counts). The scores of a node's children are
+     * computed by the vectorized select_puct_child kernel over the contiguous
+     * edge arrays. Updates the board state accordingly.
+     * Adds a virtual loss to every node on the path so that concurrent
+     * selections spread over different branches. Stops early when the graph
+     * leads back to a node already on the path.
      *
      * @param parent_node Node where to start selection
      * @param board Current board state (will be modified with selected move)
+     * @param path Receives the (node, edge taken) steps of the selection
+     * @param forced_first_edge Edge taken from parent_node, kNullEdge to select it by PUCT
      *
      * @return Pair of (selected child node, corresponding board state)
      */
-    std::pair<std::shared_ptr<Mcts_agent::Node>, Board> select_child_for_playout(
-        const std::shared_ptr<Node>& parent_node, Board board);
+    std::pair<NodeIndex, Board> select_child_for_playout(NodeIndex parent_node, Board board,
+                                                         std::vector<std::pair<NodeIndex, EdgeIndex>>& path,
+                                                         EdgeIndex forced_first_edge = kNullEdge);
 
     /**
      * @brief Computes the Predictor + Upper Confidence Bound (PUCT) score
@@ -280,13 +1227,14 @@ private:
      *
      * Formula: Q(s,a) + c_puct * P(s,a) * sqrt(N(s)) / (1 + N(s,a))
      *
-     * @param child_node Child node being evaluated
+     * Scalar version of the selection kernel, used for detailed logging.
+     *
+     * @param child_edge Edge leading to the child being evaluated
      * @param parent_node Parent node providing context for visit count
      *
      * @return PUCT score for the child node
      */
-    double calculate_puct_score(const std::shared_ptr<Node>& child_node,
-                                const std::shared_ptr<Node>& parent_node);
+    double calculate_puct_score(EdgeIndex child_edge, const Node& parent_node) const;
 
     /**
      * @brief Simulates random playout from a given node
@@ -301,35 +1249,58 @@ private:
      * @param board Board state to simulate from (copied, original unchanged)
      *
      * @return Game outcome value from the perspective of the node's player
+     *         (±1 for solved nodes, the network value otherwise)
+     *
+     * @note If another thread is already expanding the node, waits for its
+     *       evaluation instead of querying the network twice.
      */
-    float simulate_random_playout(const std::shared_ptr<Node>& node, Board board);
+    float simulate_random_playout(NodeIndex node, Board board);
 
     /**
      * @brief Backpropagates simulation results through the MCTS tree
      *
-     * Updates visit counts and accumulated values from the given node up to
-     * the root. The value is propagated with sign flips at each level to
-     * maintain proper perspective for alternating players. Thread-safe via
-     * mutex locks.
+     * Updates visit counts and accumulated values of every edge and node of
+     * the selection path, from the leaf up to the root. The path is used
+     * rather than parent indices because in the graph a node can be reached
+     * from several parents. The value is propagated with sign
+     * flips at each level to maintain proper perspective for alternating players.
+     * Lock-free: statistics are updated with relaxed atomic adds, which also
+     * revert the virtual loss applied during selection.
+     *
+     * @param path (node, edge taken) steps from the root to the leaf
+     * @param value Outcome value to backpropagate (-1 to 1 scale), from the perspective of the leaf's player
+     */
+    void backpropagate(const std::vector<std::pair<NodeIndex, EdgeIndex>>& path, float value);
+
+    /**
+     * @brief Propagates a proven leaf outcome up the selection path
+     *
+     * A node is a proven win as soon as one move leads to a position lost
+     * for the opponent, and a proven loss once every move leads to a
+     * position won for the opponent. Edges into solved positions get an
+     * infinite value so selection skips lost moves. Stops at the first node
+     * that cannot be solved yet.
      *
-     * @param node Node at which to start backpropagation
-     * @param value Outcome value to backpropagate (-1 to 1 scale)
+     * @param path (node, edge taken) steps from the root to the leaf
      */
-    void backpropagate(std::shared_ptr<Node>& node, float value);
+    void propagate_proof(const std::vector<std::pair<NodeIndex, EdgeIndex>>& path);
 
     /**
      * @brief Selects the best child node based on visit counts
      *
      * Returns the child with the highest mean value estimate, which represents
-     * the most promising move according to MCTS.
+     * the most promising move according to MCTS. With by_visits, returns the
+     * most visited child instead, the move SearchBudget::early_stop waits for
+     * (proven wins and losses still rank by value).
      *
      * @param node Parent node whose best child should be selected
+     * @param by_visits Rank the children by visit count, mean value breaking ties
      *
-     * @return Shared pointer to the child node with highest visit count
+     * @return Index of the edge leading to the child with highest mean value
      *
      * @throws std::runtime_error If no child can be selected due to insufficient statistics
      */
-    std::shared_ptr<Node> select_best_child(std::shared_ptr<Node>& node);
+    EdgeIndex select_best_child(NodeIndex node, bool by_visits = false) const;
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,12 @@
 #include "nn_model.h"
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "rng.h"
+
 
 GameDataset::GameDataset(size_t max_size_) : max_size(max_size_) {
     boards.resize(max_size);
@@ -22,8 +29,7 @@ void GameDataset::add_position(torch::Tensor board, torch::Tensor pi,
 
 torch::data::Example<> GameDataset::get(size_t) {
     std::uniform_int_distribution<size_t> dist(0, max_size - 1);
-    static std::mt19937 rng(std::random_device{}());
-    size_t idx = dist(rng);
+    size_t idx = dist(thread_random());
     return {boards[idx], torch::cat({pi_targets[idx], z_targets[idx].unsqueeze(0), legal_mask[idx]})};
 }
 
@@ -132,6 +138,241 @@ torch::nn::ModuleHolder<AlphaZeroNetWithMaskImpl> AlphaZeroNetWithMaskImpl::load
 }
 
 
+FusedAlphaZeroNet::FusedAlphaZeroNet(AlphaZeroNetWithMaskImpl& model, torch::Device device) {
+    torch::NoGradGuard no_grad;
+    height = model.H;
+    width = model.W;
+    conv_in = copy_layer(model.conv_in->weight, model.conv_in->bias, "conv_in", device);
+    for (size_t i = 0; i < model.res_blocks->size(); ++i) {
+        auto* block = model.res_blocks[i]->as<torch::nn::Sequential>();
+        const std::string name = "res_blocks." + std::to_string(i);
+        // Layout of a block: conv, batch norm, relu, conv, batch norm
+        res_blocks.emplace_back(fold_batch_norm(block->at<torch::nn::Conv2dImpl>(0),
+                                                block->at<torch::nn::BatchNorm2dImpl>(1), name + ".conv1", device),
+                                fold_batch_norm(block->at<torch::nn::Conv2dImpl>(3),
+                                                block->at<torch::nn::BatchNorm2dImpl>(4), name + ".conv2", device));
+    }
+    policy_head_conv = copy_layer(model.policy_head_conv->weight, model.policy_head_conv->bias, "policy_head_conv",
+                                  device);
+    value_head_conv = copy_layer(model.value_head_conv->weight, model.value_head_conv->bias, "value_head_conv",
+                                 device);
+    policy_fc = copy_layer(model.policy_fc->weight, model.policy_fc->bias, "policy_fc", device);
+    value_fc1 = copy_layer(model.value_fc1->weight, model.value_fc1->bias, "value_fc1", device);
+    value_fc2 = copy_layer(model.value_fc2->weight, model.value_fc2->bias, "value_fc2", device);
+}
+
+FusedAlphaZeroNet::FusedLayer FusedAlphaZeroNet::copy_layer(const torch::Tensor& weight, const torch::Tensor& bias,
+                                                            std::string name, torch::Device device) {
+    FusedLayer layer;
+    layer.weight = weight.detach().to(device).contiguous();
+    if (bias.defined()) {
+        layer.bias = bias.detach().to(device).contiguous();
+    }
+    layer.padding = weight.dim() == 4 ? weight.size(-1) / 2 : 0;
+    layer.name = std::move(name);
+    return layer;
+}
+
+FusedAlphaZeroNet::FusedLayer FusedAlphaZeroNet::fold_batch_norm(const torch::nn::Conv2dImpl& conv,
+                                                                 const torch::nn::BatchNorm2dImpl& batch_norm,
+                                                                 std::string name, torch::Device device) {
+    // bn(conv(x)) = scale * (W x + b - mean) + beta, with scale = gamma / sqrt(var + eps)
+    torch::Tensor scale = batch_norm.weight.detach() * torch::rsqrt(batch_norm.running_var + batch_norm.options.eps());
+    torch::Tensor bias = conv.bias.defined() ? conv.bias.detach() : torch::zeros_like(batch_norm.running_mean);
+
+    return copy_layer(conv.weight.detach() * scale.view({-1, 1, 1, 1}),
+                      (bias - batch_norm.running_mean) * scale + batch_norm.bias.detach(), std::move(name), device);
+}
+
+torch::Tensor FusedAlphaZeroNet::run_conv(const torch::Tensor& x, const FusedLayer& conv) {
+    if (!conv.int8) {
+        return torch::conv2d(x, conv.weight, conv.bias, {1, 1}, {conv.padding, conv.padding});
+    }
+
+    // INT8 convolution: one quantized product over the unfolded patches of every board cell
+    const int64_t batch = x.size(0);
+    const int64_t height = x.size(2);
+    const int64_t width = x.size(3);
+    const int64_t kernel = conv.weight.size(-1);
+    torch::Tensor patches = torch::nn::functional::unfold(
+        x, torch::nn::functional::UnfoldFuncOptions({kernel, kernel}).padding(conv.padding));
+    patches = patches.transpose(1, 2).reshape({batch * height * width, -1});
+    torch::Tensor out = run_linear(patches, conv);
+    return out.view({batch, height * width, -1}).transpose(1, 2).reshape({batch, -1, height, width});
+}
+
+torch::Tensor FusedAlphaZeroNet::run_linear(const torch::Tensor& x, const FusedLayer& linear) {
+    if (!linear.int8) {
+        return torch::linear(x, linear.weight, linear.bias);
+    }
+    const Int8Weight& q = *linear.int8;
+    return torch::fbgemm_linear_int8_weight_fp32_activation(x.contiguous(), q.weight, q.packed, q.col_offsets,
+                                                             q.scale, q.zero_point, linear.bias);
+}
+
+std::pair<torch::Tensor, torch::Tensor> FusedAlphaZeroNet::forward(const torch::Tensor& x,
+                                                                    const torch::Tensor& legal_mask) const {
+    torch::Tensor trunk = run_conv(x, conv_in).relu_();
+
+    // The skip connection reads the block input, which the block never modifies: no clone is needed
+    for (const auto& [first, second] : res_blocks) {
+        torch::Tensor y = run_conv(trunk, first).relu_();
+        trunk = run_conv(y, second).add_(trunk).relu_();
+    }
+
+    // --- Policy Head ---
+    torch::Tensor p = run_conv(trunk, policy_head_conv).view({trunk.size(0), -1});
+    p = run_linear(p, policy_fc);
+    if (legal_mask.defined()) {
+        p.masked_fill_(legal_mask == 0, -1e9);
+    }
+    p = torch::log_softmax(p, 1);
+
+    // --- Value Head ---
+    torch::Tensor v = run_conv(trunk, value_head_conv).view({trunk.size(0), -1});
+    v = run_linear(v, value_fc1).relu_();
+    v = run_linear(v, value_fc2).tanh_().squeeze(-1);
+
+    return {p, v};
+}
+
+std::vector<FusedAlphaZeroNet::FusedLayer*> FusedAlphaZeroNet::int8_candidates() {
+    std::vector<FusedLayer*> layers = {&conv_in};
+    for (auto& [first, second] : res_blocks) {
+        layers.push_back(&first);
+        layers.push_back(&second);
+    }
+    layers.push_back(&policy_fc);
+    layers.push_back(&value_fc1);
+    return layers;
+}
+
+FusedAlphaZeroNet::Int8Weight FusedAlphaZeroNet::quantize_weight(const torch::Tensor& weight) {
+    Int8Weight q;
+    auto [q_weight, col_offsets, scale, zero_point] =
+        torch::fbgemm_linear_quantize_weight(weight.reshape({weight.size(0), -1}).contiguous());
+    q.weight = q_weight;
+    q.packed = torch::fbgemm_pack_quantized_matrix(q_weight);
+    q.col_offsets = col_offsets;
+    q.scale = scale;
+    q.zero_point = zero_point;
+    return q;
+}
+
+void FusedAlphaZeroNet::disable_int8() {
+    for (FusedLayer* layer : int8_candidates()) {
+        layer->int8.reset();
+    }
+}
+
+NetworkWeights::Layer FusedAlphaZeroNet::export_layer(const FusedLayer& layer) {
+    NetworkWeights::Layer out;
+    torch::Tensor weight = layer.weight.to(torch::kCPU).contiguous();
+    out.weight.assign(weight.data_ptr<float>(), weight.data_ptr<float>() + weight.numel());
+    if (layer.bias.defined()) {
+        torch::Tensor bias = layer.bias.to(torch::kCPU).contiguous();
+        out.bias.assign(bias.data_ptr<float>(), bias.data_ptr<float>() + bias.numel());
+    } else {
+        out.bias.assign(layer.weight.size(0), 0.0f);
+    }
+    return out;
+}
+
+NetworkWeights FusedAlphaZeroNet::export_weights() const {
+    NetworkWeights weights;
+    weights.input_channels = static_cast<int>(conv_in.weight.size(1));
+    weights.height = height;
+    weights.width = width;
+    weights.num_moves = static_cast<int>(policy_fc.weight.size(0));
+    weights.channels = static_cast<int>(conv_in.weight.size(0));
+    weights.conv_in = export_layer(conv_in);
+    for (const auto& [first, second] : res_blocks) {
+        weights.res_convs.push_back(export_layer(first));
+        weights.res_convs.push_back(export_layer(second));
+    }
+    weights.policy_head_conv = export_layer(policy_head_conv);
+    weights.value_head_conv = export_layer(value_head_conv);
+    weights.policy_fc = export_layer(policy_fc);
+    weights.value_fc1 = export_layer(value_fc1);
+    weights.value_fc2 = export_layer(value_fc2);
+    return weights;
+}
+
+QuantizationReport FusedAlphaZeroNet::calibrate_int8(const torch::Tensor& inputs, const torch::Tensor& legal_masks,
+                                                     double max_policy_kl) {
+    if (conv_in.weight.device().type() != torch::kCPU || !torch::fbgemm_is_cpu_supported()) {
+        throw std::runtime_error("INT8 inference needs the network on a CPU supported by FBGEMM");
+    }
+    torch::NoGradGuard no_grad;
+
+    disable_int8();
+    auto [reference_policy, reference_value] = forward(inputs, legal_masks);
+    auto policy_kl = [&](const torch::Tensor& policy) {
+        // Illegal moves have a reference probability of 0 and do not contribute
+        return (reference_policy.exp() * (reference_policy - policy)).sum(1).mean().item<double>();
+    };
+
+    // Sensitivity of every candidate layer quantized alone
+    std::vector<FusedLayer*> candidates = int8_candidates();
+    std::vector<Int8Weight> quantized;
+    std::vector<std::pair<double, std::size_t>> sensitivity;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        quantized.push_back(quantize_weight(candidates[i]->weight));
+        candidates[i]->int8 = quantized.back();
+        sensitivity.emplace_back(policy_kl(forward(inputs, legal_masks).first), i);
+        candidates[i]->int8.reset();
+    }
+
+    // Greedy selection from the least sensitive layer, on the divergence of the whole network
+    std::sort(sensitivity.begin(), sensitivity.end());
+    for (const auto& [alone_kl, i] : sensitivity) {
+        if (alone_kl > max_policy_kl) {
+            break;
+        }
+        candidates[i]->int8 = quantized[i];
+        if (policy_kl(forward(inputs, legal_masks).first) > max_policy_kl) {
+            candidates[i]->int8.reset();
+        }
+    }
+
+    QuantizationReport report;
+    report.positions = static_cast<int>(inputs.size(0));
+    for (FusedLayer* layer : candidates) {
+        if (layer->int8) {
+            report.int8_layers.push_back(layer->name);
+        }
+    }
+    auto [policy, value] = forward(inputs, legal_masks);
+    report.policy_kl = policy_kl(policy);
+    report.top1_agreement =
+        (policy.argmax(1) == reference_policy.argmax(1)).to(torch::kFloat64).mean().item<double>();
+    torch::Tensor value_error = (value - reference_value).abs();
+    report.value_mean_error = value_error.mean().item<double>();
+    report.value_max_error = value_error.max().item<double>();
+
+    // Single-position latency, as seen by a search thread
+    const int64_t timed = std::min<int64_t>(inputs.size(0), 64);
+    auto mean_latency_us = [&]() {
+        forward(inputs.narrow(0, 0, 1), legal_masks.narrow(0, 0, 1));  // Warm-up
+        const auto start = std::chrono::steady_clock::now();
+        for (int64_t i = 0; i < timed; ++i) {
+            forward(inputs.narrow(0, i, 1), legal_masks.narrow(0, i, 1));
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / timed;
+    };
+    report.int8_latency_us = mean_latency_us();
+    std::vector<std::optional<Int8Weight>> chosen;
+    for (FusedLayer* layer : candidates) {
+        chosen.push_back(std::exchange(layer->int8, std::nullopt));
+    }
+    report.fp32_latency_us = mean_latency_us();
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i]->int8 = std::move(chosen[i]);
+    }
+    return report;
+}
+
+
 torch::Tensor alphazero_loss(torch::Tensor policy_pred, torch::Tensor value_pred,
                              torch::Tensor pi_target, torch::Tensor z_target) {
 
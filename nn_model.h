@@ -5,8 +5,10 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <optional>
 #include <random>
 #include "cell_state.h"
+#include "cpu_engine.h"
 
 
 /**
@@ -123,6 +125,168 @@ struct AlphaZeroNetWithMaskImpl : torch::nn::Module {
 TORCH_MODULE(AlphaZeroNetWithMask);
 
 
+/**
+ * @brief Agreement of an INT8 network with its fp32 version, measured by FusedAlphaZeroNet::calibrate_int8
+ */
+struct QuantizationReport {
+    /**
+     * @brief Positions the comparison ran on
+     */
+    int positions = 0;
+
+    /**
+     * @brief Layers running in INT8; the others stayed in fp32 because they were too sensitive
+     */
+    std::vector<std::string> int8_layers;
+
+    /**
+     * @brief Mean KL divergence from the fp32 policy to the INT8 policy
+     */
+    double policy_kl = 0.0;
+
+    /**
+     * @brief Fraction of positions where both policies have the same most likely move
+     */
+    double top1_agreement = 0.0;
+
+    /**
+     * @brief Mean and largest absolute difference of the value predictions
+     */
+    double value_mean_error = 0.0;
+    double value_max_error = 0.0;
+
+    /**
+     * @brief Mean latency of one single-position evaluation in microseconds
+     */
+    double fp32_latency_us = 0.0;
+    double int8_latency_us = 0.0;
+};
+
+
+/**
+ * @brief Inference-only copy of AlphaZeroNetWithMask with BatchNorm folded into the convolutions
+ * 
+ * Each residual block becomes two convolutions with fused bias: the
+ * BatchNorm statistics are folded into the conv weights once, at load time.
+ * The forward pass calls the functional ops directly, applies ReLU in place
+ * and adds the skip connection in place, so no BatchNorm kernel, clone or
+ * module dispatch remains. Outputs match the eval-mode network up to
+ * floating-point rounding.
+ *
+ * On CPU, the 3x3 convolutions and the large linear layers can run with
+ * INT8 weights (dynamic quantization: activations are quantized on the fly
+ * by FBGEMM, convolutions run as an INT8 product over unfolded patches).
+ * calibrate_int8 chooses the layers from stored positions.
+ */
+class FusedAlphaZeroNet {
+public:
+    /**
+     * @brief Folds the weights of a trained network
+     * 
+     * @param model Network to copy (its BatchNorm running statistics are used)
+     * @param device Device holding the folded weights
+     */
+    FusedAlphaZeroNet(AlphaZeroNetWithMaskImpl& model, torch::Device device);
+
+    /**
+     * @brief Forward pass, same contract as AlphaZeroNetWithMaskImpl::forward
+     * 
+     * @param x Input board state tensor
+     * @param legal_mask Optional mask for legal moves
+     * 
+     * @return Pair of policy log-probabilities and value prediction
+     */
+    std::pair<torch::Tensor, torch::Tensor> forward(const torch::Tensor& x,
+                                                     const torch::Tensor& legal_mask = torch::Tensor()) const;
+
+    /**
+     * @brief Switches the least sensitive layers to INT8 while the policy stays close to fp32
+     *
+     * Every candidate layer is quantized alone to measure the policy KL
+     * divergence it causes on the positions. Layers are then added from the
+     * least to the most sensitive, each kept only if the divergence of the
+     * whole network stays within max_policy_kl. Finally the INT8 network is
+     * compared with the fp32 one and both are timed on single positions.
+     *
+     * Must not run concurrently with forward.
+     *
+     * @param inputs Calibration positions, as stacked Board::to_tensor planes
+     * @param legal_masks Legal move masks of the positions
+     * @param max_policy_kl Largest mean policy KL divergence accepted
+     *
+     * @return Layers chosen and accuracy of the result
+     *
+     * @throws std::runtime_error if the weights are not on a CPU supported by FBGEMM
+     */
+    QuantizationReport calibrate_int8(const torch::Tensor& inputs, const torch::Tensor& legal_masks,
+                                      double max_policy_kl = 0.01);
+
+    /**
+     * @brief Runs every layer in fp32 again
+     */
+    void disable_int8();
+
+    /**
+     * @brief Copies the folded fp32 weights to plain arrays, for CpuInferenceEngine
+     *
+     * INT8 weights chosen by calibrate_int8 are ignored: the fp32 weights are copied.
+     */
+    NetworkWeights export_weights() const;
+
+private:
+    /**
+     * @brief Weight of a layer quantized to INT8 and packed for FBGEMM (per-tensor scale)
+     */
+    struct Int8Weight {
+        torch::Tensor weight;
+        torch::Tensor packed;
+        torch::Tensor col_offsets;
+        double scale;
+        int64_t zero_point;
+    };
+
+    /**
+     * @brief Convolution (with its BatchNorm folded in) or linear layer
+     */
+    struct FusedLayer {
+        torch::Tensor weight;
+        torch::Tensor bias;
+        int64_t padding = 0;
+        std::string name;
+        std::optional<Int8Weight> int8;
+    };
+
+    FusedLayer conv_in;
+    std::vector<std::pair<FusedLayer, FusedLayer>> res_blocks;
+    FusedLayer policy_head_conv;
+    FusedLayer value_head_conv;
+    FusedLayer policy_fc;
+    FusedLayer value_fc1;
+    FusedLayer value_fc2;
+    int height;
+    int width;
+
+    static FusedLayer copy_layer(const torch::Tensor& weight, const torch::Tensor& bias, std::string name,
+                                 torch::Device device);
+    static FusedLayer fold_batch_norm(const torch::nn::Conv2dImpl& conv, const torch::nn::BatchNorm2dImpl& batch_norm,
+                                      std::string name, torch::Device device);
+    static torch::Tensor run_conv(const torch::Tensor& x, const FusedLayer& conv);
+    static torch::Tensor run_linear(const torch::Tensor& x, const FusedLayer& linear);
+
+    /**
+     * @brief Layers worth quantizing: the trunk convolutions, policy_fc and value_fc1
+     */
+    std::vector<FusedLayer*> int8_candidates();
+
+    /**
+     * @brief Quantizes the weight of a layer (kept 2-D: output channels x inputs)
+     */
+    static Int8Weight quantize_weight(const torch::Tensor& weight);
+
+    static NetworkWeights::Layer export_layer(const FusedLayer& layer);
+};
+
+
 /**
  * @brief Computes the AlphaZero combined loss function
  * 
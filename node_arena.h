@@ -0,0 +1,108 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief 32-bit index addressing a node inside a NodeArena
+ */
+using NodeIndex = std::uint32_t;
+
+/**
+ * @brief Sentinel index meaning "no node" (parent of the root, unallocated child)
+ */
+constexpr NodeIndex kNullNode = std::numeric_limits<NodeIndex>::max();
+
+/**
+ * @brief Fixed-capacity bump allocator for search tree nodes
+ *
+ * Nodes live in one contiguous block and are addressed by 32-bit indices
+ * instead of pointers. Allocation hands out contiguous index ranges, so all
+ * children of a node sit next to each other in memory. Nodes are never freed
+ * individually: the whole arena is released in bulk with clear(), which makes
+ * the memory used by a search bounded by the capacity given at construction.
+ * allocate() is lock-free and may be called from several search threads;
+ * clear() must not race with allocations.
+ *
+ * @tparam T Node type stored in the arena
+ */
+template <typename T>
+class NodeArena {
+public:
+    /**
+     * @brief Constructs an arena able to hold up to capacity nodes
+     *
+     * @param capacity Maximum number of nodes
+     */
+    explicit NodeArena(std::size_t capacity = 0)
+        : storage(capacity > 0 ? std::make_unique<T[]>(capacity) : nullptr),
+          node_capacity(capacity),
+          node_count(0) {}
+
+    /**
+     * @brief Allocates a contiguous range of nodes
+     *
+     * @param count Number of nodes to allocate
+     *
+     * @return Index of the first node of the range, or kNullNode if the arena is full
+     */
+    NodeIndex allocate(std::size_t count) {
+        std::size_t first = node_count.load(std::memory_order_relaxed);
+        do {
+            if (count > node_capacity - first) {
+                return kNullNode;
+            }
+        } while (!node_count.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+        return static_cast<NodeIndex>(first);
+    }
+
+    /**
+     * @brief Releases every node at once
+     */
+    void clear() { node_count.store(0, std::memory_order_relaxed); }
+
+    /**
+     * @brief Exchanges the contents of two arenas
+     *
+     * Used to move a compacted tree into place. Must not race with allocations.
+     *
+     * @param other Arena to exchange with
+     */
+    void swap(NodeArena& other) {
+        storage.swap(other.storage);
+        std::swap(node_capacity, other.node_capacity);
+        std::size_t count = node_count.load(std::memory_order_relaxed);
+        node_count.store(other.node_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.node_count.store(count, std::memory_order_relaxed);
+    }
+
+    T& operator[](NodeIndex index) { return storage[index]; }
+    const T& operator[](NodeIndex index) const { return storage[index]; }
+
+    /**
+     * @brief Number of nodes currently allocated
+     */
+    std::size_t size() const { return node_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Maximum number of nodes the arena can hold
+     */
+    std::size_t capacity() const { return node_capacity; }
+
+    /**
+     * @brief Memory used by the allocated nodes in bytes
+     */
+    std::size_t bytes_used() const { return size() * sizeof(T); }
+
+private:
+    std::unique_ptr<T[]> storage;
+    std::size_t node_capacity;
+    std::atomic<std::size_t> node_count;
+};
+
+#endif // NODE_ARENA_H
@@ -1,5 +1,6 @@
 #include "player.h"
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 
@@ -43,17 +44,36 @@ std::pair<std::array<int, 4>,torch::Tensor> Human_player::choose_move(const Boar
 
 Mcts_player::Mcts_player(double exploration_factor,
                          int number_iteration,
-                         LogLevel log_level)
+                         LogLevel log_level,
+                         const MctsPlayerOptions& options)
     : exploration_factor(exploration_factor),
       number_iteration(number_iteration),
-      log_level(log_level) {}
+      log_level(log_level),
+      options(options),
+      cheap_iterations(options.cheap_iterations > 0 ? options.cheap_iterations
+                                                    : std::max(1, number_iteration / 8)),
+      full_search(true),
+      agent(std::make_unique<Mcts_agent>(exploration_factor, number_iteration, log_level,
+                                         options.num_threads, options.ponder, options.parallel_mode,
+                                         options.max_tree_bytes, options.memory_policy)) {}
+
+Mcts_player::~Mcts_player() = default;
 
 std::pair<std::array<int, 4>,torch::Tensor> Mcts_player::choose_move(const Board& board,
                                              Cell_state player) {
+  SearchBudget budget;
+  budget.max_iterations = full_search ? number_iteration : cheap_iterations;
+  budget.max_time = options.time_budget;
+  budget.early_stop = options.early_stop;
+  budget.root_noise = full_search;
+  budget.gumbel_root = options.gumbel_root;
+  return agent->choose_move(board, player, budget);
+}
 
-  Mcts_agent agent(exploration_factor, number_iteration, log_level);
+void Mcts_player::set_full_search(bool full) { full_search = full; }
 
-  return agent.choose_move(board, player);
-}
+const SearchStats& Mcts_player::last_search_stats() const { return agent->last_search_stats(); }
+
+void Mcts_player::set_tree_export(const std::string& path) { agent->set_tree_export(path); }
 
 LogLevel Mcts_player::get_verbose_level() const { return log_level; }
\ No newline at end of file
@@ -2,10 +2,12 @@
 #define PLAYER_H
 
 #include <chrono>
+#include <memory>
 #include <utility>
 
 #include "board.h"
 #include "logger.h"
+#include "mcts_agent.h"
 #include <torch/torch.h>
 
 /**
@@ -16,6 +18,8 @@
  */
 class Player {
  public:
+  virtual ~Player() = default;
+
   /**
    * @brief Abstract function for choosing a move on the game board
    *
@@ -27,6 +31,15 @@ class Player {
   virtual std::pair<std::array<int, 4>, torch::Tensor> choose_move(
       const Board& board,
       Cell_state player) = 0;
+
+  /**
+   * @brief Selects a full or a cheap search for the next move (playout cap randomization)
+   *
+   * Players that do not search ignore it.
+   *
+   * @param full True for a full search, false for a fast one
+   */
+  virtual void set_full_search(bool /*full*/) {}
 };
 
 /**
@@ -52,6 +65,58 @@ class Human_player : public Player {
       Cell_state player) override;
 };
 
+/**
+ * @brief Search settings of an Mcts_player besides its exploration factor and iteration count
+ *
+ * Set the fields by name, so that adding a setting never shifts the others.
+ */
+struct MctsPlayerOptions {
+  /**
+   * @brief Number of search threads
+   */
+  int num_threads = 1;
+
+  /**
+   * @brief Wall-clock budget per move (0 for no time limit)
+   */
+  std::chrono::milliseconds time_budget{0};
+
+  /**
+   * @brief Stop searching once the best move can no longer change
+   */
+  bool early_stop = false;
+
+  /**
+   * @brief Search during the opponent's turn and reuse the tree between moves
+   */
+  bool ponder = false;
+
+  /**
+   * @brief Shared-tree or root-parallel search when num_threads > 1
+   */
+  ParallelMode parallel_mode = ParallelMode::Tree;
+
+  /**
+   * @brief Iterations of a cheap search (0 for number_iteration / 8)
+   */
+  int cheap_iterations = 0;
+
+  /**
+   * @brief Use the Gumbel root with sequential halving (for small budgets)
+   */
+  bool gumbel_root = false;
+
+  /**
+   * @brief Memory cap of the search tree (0 to size it from the search budget)
+   */
+  std::size_t max_tree_bytes = 0;
+
+  /**
+   * @brief Refine only or recycle subtrees once the tree is full
+   */
+  TreeMemoryPolicy memory_policy = TreeMemoryPolicy::Refine;
+};
+
 /**
  * @brief Mcts_player is a concrete class derived from the Player base class,
  * embodying a player that utilizes the MCTS algorithm for decision making
@@ -59,6 +124,8 @@ class Human_player : public Player {
  *
  * The choose_move() function selects the best move based on MCTS,
  * considering an exploration factor, max iteration number, and level of logging.
+ * The player keeps one agent for the whole game, so the network is loaded
+ * once and, when pondering, the search continues during the opponent's turn.
  */
 class Mcts_player : public Player {
  public:
@@ -68,10 +135,14 @@ class Mcts_player : public Player {
    * @param exploration_factor Exploration factor for MCTS
    * @param number_iteration Maximum iteration number
    * @param log_level Log Level
+   * @param options Threads, time limit and the other search settings
    */
   Mcts_player(double exploration_factor,
               int number_iteration,
-              LogLevel log_level = LogLevel::NONE);
+              LogLevel log_level = LogLevel::NONE,
+              const MctsPlayerOptions& options = {});
+
+  ~Mcts_player() override;
 
   /**
    * @brief Implementation of the choose_move function for the Mcts_player class
@@ -92,10 +163,35 @@ class Mcts_player : public Player {
    */
   LogLevel get_verbose_level() const;
 
+  /**
+   * @brief Full search: number_iteration with root noise, cheap: cheap_iterations without noise
+   *
+   * @param full True for a full search, false for a fast one
+   */
+  void set_full_search(bool full) override;
+
+  /**
+   * @brief Performance figures of the last search
+   *
+   * @return Statistics of the last call to choose_move
+   */
+  const SearchStats& last_search_stats() const;
+
+  /**
+   * @brief Dumps the search tree of every following move to a file
+   *
+   * @param path File overwritten after each search, empty to stop dumping
+   */
+  void set_tree_export(const std::string& path);
+
  private:
   double exploration_factor;  // The exploration factor used in MCTS
   int number_iteration;       // The maximum number of iterations
   LogLevel log_level;            // Verbose level
+  MctsPlayerOptions options;  // Threads, time limit and search settings
+  int cheap_iterations;       // Iterations of a cheap search
+  bool full_search;           // Whether the next search is a full one
+  std::unique_ptr<Mcts_agent> agent;  // Search engine kept across moves
 };
 
 #endif
\ No newline at end of file
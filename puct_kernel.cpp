@@ -0,0 +1,135 @@
+#include "puct_kernel.h"
+
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Reduces per-lane best scores to the overall best, lowest index first on ties
+ */
+template <int Lanes>
+void reduce_lanes(const float (&scores)[Lanes], const std::int32_t (&indices)[Lanes],
+                  float& best_score, std::uint32_t& best_index) {
+    for (int lane = 0; lane < Lanes; ++lane) {
+        std::uint32_t index = static_cast<std::uint32_t>(indices[lane]);
+        if (scores[lane] > best_score || (scores[lane] == best_score && index < best_index)) {
+            best_score = scores[lane];
+            best_index = index;
+        }
+    }
+}
+
+inline float puct_score(float prior, std::int32_t visits, float value_sum, float c_sqrt_n) {
+    float q_value = visits > 0 ? value_sum / visits : 0.0f;
+    return q_value + c_sqrt_n * prior / (1.0f + visits);
+}
+
+}  // namespace
+
+std::uint32_t select_puct_child_scalar(const float* priors, const std::int32_t* visits,
+                                       const float* value_sums, std::uint32_t count,
+                                       float c_sqrt_n, float& best_score) {
+    std::uint32_t best_index = 0;
+    best_score = puct_score(priors[0], visits[0], value_sums[0], c_sqrt_n);
+    for (std::uint32_t i = 1; i < count; ++i) {
+        float score = puct_score(priors[i], visits[i], value_sums[i], c_sqrt_n);
+        if (score > best_score) {
+            best_score = score;
+            best_index = i;
+        }
+    }
+    return best_index;
+}
+
+std::uint32_t select_puct_child(const float* priors, const std::int32_t* visits,
+                                const float* value_sums, std::uint32_t count,
+                                float c_sqrt_n, float& best_score) {
+#if !defined(__AVX512F__) && !defined(__AVX2__)
+    return select_puct_child_scalar(priors, visits, value_sums, count, c_sqrt_n, best_score);
+#else
+    std::uint32_t i = 0;
+    std::uint32_t best_index = std::numeric_limits<std::uint32_t>::max();
+    best_score = -std::numeric_limits<float>::infinity();
+
+#if defined(__AVX512F__)
+    if (count >= 16) {
+        const __m512 c = _mm512_set1_ps(c_sqrt_n);
+        const __m512 one = _mm512_set1_ps(1.0f);
+        const __m512 zero = _mm512_setzero_ps();
+        __m512 lane_best = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+        __m512i lane_index = _mm512_setzero_si512();
+        __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m512i step = _mm512_set1_epi32(16);
+
+        for (; i + 16 <= count; i += 16) {
+            __m512 p = _mm512_loadu_ps(priors + i);
+            __m512 n = _mm512_cvtepi32_ps(_mm512_loadu_si512(visits + i));
+            __m512 s = _mm512_loadu_ps(value_sums + i);
+
+            __mmask16 visited = _mm512_cmp_ps_mask(n, zero, _CMP_GT_OQ);
+            __m512 q = _mm512_maskz_div_ps(visited, s, n);
+            __m512 u = _mm512_div_ps(_mm512_mul_ps(c, p), _mm512_add_ps(one, n));
+            __m512 score = _mm512_add_ps(q, u);
+
+            __mmask16 better = _mm512_cmp_ps_mask(score, lane_best, _CMP_GT_OQ);
+            lane_best = _mm512_mask_blend_ps(better, lane_best, score);
+            lane_index = _mm512_mask_blend_epi32(better, lane_index, index);
+            index = _mm512_add_epi32(index, step);
+        }
+
+        alignas(64) float scores[16];
+        alignas(64) std::int32_t indices[16];
+        _mm512_store_ps(scores, lane_best);
+        _mm512_store_si512(indices, lane_index);
+        reduce_lanes<16>(scores, indices, best_score, best_index);
+    }
+#elif defined(__AVX2__)
+    if (count >= 8) {
+        const __m256 c = _mm256_set1_ps(c_sqrt_n);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 lane_best = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+        __m256 lane_index = _mm256_castsi256_ps(_mm256_setzero_si256());
+        __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i step = _mm256_set1_epi32(8);
+
+        for (; i + 8 <= count; i += 8) {
+            __m256 p = _mm256_loadu_ps(priors + i);
+            __m256 n = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(visits + i)));
+            __m256 s = _mm256_loadu_ps(value_sums + i);
+
+            // Unvisited children have Q = 0: mask out the 0/0 lanes
+            __m256 visited = _mm256_cmp_ps(n, zero, _CMP_GT_OQ);
+            __m256 q = _mm256_and_ps(_mm256_div_ps(s, n), visited);
+            __m256 u = _mm256_div_ps(_mm256_mul_ps(c, p), _mm256_add_ps(one, n));
+            __m256 score = _mm256_add_ps(q, u);
+
+            __m256 better = _mm256_cmp_ps(score, lane_best, _CMP_GT_OQ);
+            lane_best = _mm256_blendv_ps(lane_best, score, better);
+            lane_index = _mm256_blendv_ps(lane_index, _mm256_castsi256_ps(index), better);
+            index = _mm256_add_epi32(index, step);
+        }
+
+        alignas(32) float scores[8];
+        alignas(32) std::int32_t indices[8];
+        _mm256_store_ps(scores, lane_best);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), _mm256_castps_si256(lane_index));
+        reduce_lanes<8>(scores, indices, best_score, best_index);
+    }
+#endif
+
+    // Children left over after the last full vector
+    for (; i < count; ++i) {
+        float score = puct_score(priors[i], visits[i], value_sums[i], c_sqrt_n);
+        if (score > best_score || best_index == std::numeric_limits<std::uint32_t>::max()) {
+            best_score = score;
+            best_index = i;
+        }
+    }
+    return best_index;
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef PUCT_KERNEL_H
+#define PUCT_KERNEL_H
+
+#include <cstdint>
+
+/**
+ * @brief Finds the child with the highest PUCT score
+ *
+ * Evaluates, for every child i of an expanded node,
+ *
+ *     Q(i) + c_sqrt_n * P(i) / (1 + N(i))
+ *
+ * where Q(i) = value_sums[i] / visits[i] (0 for unvisited children) and
+ * c_sqrt_n = c_puct * sqrt(N(parent)) is computed once by the caller.
+ * The children statistics are read from contiguous arrays so the loop runs
+ * on 16 (AVX-512) or 8 (AVX2) children at a time; when the compiler targets
+ * neither instruction set, select_puct_child_scalar runs instead.
+ *
+ * The arrays are read with plain loads: visits and value_sums must not be
+ * updated while the kernel runs (see EdgeArena::snapshot).
+ *
+ * Ties are resolved in favour of the lowest index.
+ *
+ * @param priors Prior probabilities of the children
+ * @param visits Visit counts of the children
+ * @param value_sums Accumulated values of the children
+ * @param count Number of children (must be at least 1)
+ * @param c_sqrt_n Exploration constant multiplied by sqrt of the parent visit count
+ * @param best_score Receives the score of the selected child
+ *
+ * @return Index of the selected child in [0, count)
+ */
+std::uint32_t select_puct_child(const float* priors,
+                                const std::int32_t* visits,
+                                const float* value_sums,
+                                std::uint32_t count,
+                                float c_sqrt_n,
+                                float& best_score);
+
+/**
+ * @brief Scalar implementation of select_puct_child, with the same result and tie rule
+ *
+ * Used when no vector instruction set is available, and as the reference
+ * the vectorized kernel is tested against.
+ */
+std::uint32_t select_puct_child_scalar(const float* priors,
+                                       const std::int32_t* visits,
+                                       const float* value_sums,
+                                       std::uint32_t count,
+                                       float c_sqrt_n,
+                                       float& best_score);
+
+#endif // PUCT_KERNEL_H
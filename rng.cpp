@@ -0,0 +1,51 @@
+#include "rng.h"
+
+#include <atomic>
+#include <random>
+
+namespace {
+
+std::uint64_t initial_seed() {
+    std::random_device device;
+    return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+}
+
+std::atomic<std::uint64_t> run_seed{initial_seed()};
+std::atomic<std::uint64_t> next_stream{0};
+
+// Bumped by seed_random so that per-thread generators reseed themselves
+std::atomic<std::uint64_t> seed_generation{0};
+
+struct ThreadRandom {
+    std::uint64_t generation = ~0ULL;
+    Xoshiro256 generator;
+};
+
+thread_local ThreadRandom thread_generator;
+
+}  // namespace
+
+void seed_random(std::uint64_t seed) {
+    run_seed.store(seed, std::memory_order_relaxed);
+    next_stream.store(0, std::memory_order_relaxed);
+    seed_generation.fetch_add(1, std::memory_order_release);
+}
+
+std::uint64_t random_seed() { return run_seed.load(std::memory_order_relaxed); }
+
+Xoshiro256 make_random_stream() {
+    std::uint64_t counter = run_seed.load(std::memory_order_relaxed);
+    const std::uint64_t stream = next_stream.fetch_add(1, std::memory_order_relaxed);
+    // Mix the stream number into the seed so that consecutive streams are unrelated
+    counter ^= Xoshiro256::splitmix64(counter) + stream * 0xD1B54A32D192ED03ULL;
+    return Xoshiro256(Xoshiro256::splitmix64(counter));
+}
+
+Xoshiro256& thread_random() {
+    const std::uint64_t generation = seed_generation.load(std::memory_order_acquire);
+    if (thread_generator.generation != generation) {
+        thread_generator.generation = generation;
+        thread_generator.generator = make_random_stream();
+    }
+    return thread_generator.generator;
+}
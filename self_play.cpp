@@ -0,0 +1,212 @@
+#include "self_play.h"
+
+#include <algorithm>
+
+#include "eval_scheduler.h"
+
+SelfPlayDriver::SelfPlayDriver(std::shared_ptr<NeuralN> network, GameDataset& dataset, int concurrent_games,
+                               double exploration_factor, int full_iterations, int cheap_iterations,
+                               double full_search_probability, int board_size, int search_threads)
+    : network(std::move(network)),
+      dataset(dataset),
+      full_iterations(full_iterations),
+      cheap_iterations(cheap_iterations > 0 ? cheap_iterations : std::max(1, full_iterations / 8)),
+      full_search_probability(full_search_probability),
+      board_size(board_size),
+      search_threads(search_threads),
+      random_generator(make_random_stream()),
+      batch_count(0),
+      evaluation_count(0) {
+    games.reserve(std::max(1, concurrent_games));
+    for (int i = 0; i < std::max(1, concurrent_games); ++i) {
+        games.push_back(GameSlot{Board(board_size), Cell_state::X, 0, false, false, false,
+                                 std::make_unique<Mcts_agent>(this->network, exploration_factor, full_iterations),
+                                 {}});
+    }
+}
+
+int SelfPlayDriver::run(std::size_t target_positions) {
+    target_positions = std::min(target_positions, dataset.max_size);
+    return search_threads > 0 ? run_coroutines(target_positions) : run_stepwise(target_positions);
+}
+
+int SelfPlayDriver::run_stepwise(std::size_t target_positions) {
+    int games_completed = 0;
+
+    // Each game writes its leaf straight into one row of the network buffers
+    BufferLease lease = network->buffers(games.size());
+    InferenceBuffers& buffers = *lease;
+    EvaluationRequest request;
+    std::vector<std::size_t> owners;
+    owners.reserve(games.size());
+    while (true) {
+        // Advance every game up to its next network evaluation, starting new games while samples are missing
+        owners.clear();
+        for (std::size_t i = 0; i < games.size(); ++i) {
+            GameSlot& game = games[i];
+            while (true) {
+                if (!game.active) {
+                    if (dataset.current_size >= target_positions) {
+                        break;
+                    }
+                    start_game(game);
+                }
+                if (advance(game, request)) {
+                    std::copy(request.input.begin(), request.input.end(), buffers.input(owners.size()));
+                    std::copy(request.legal_mask.begin(), request.legal_mask.end(),
+                              buffers.legal_mask(owners.size()));
+                    owners.push_back(i);
+                    break;
+                }
+                games_completed++;
+            }
+        }
+        if (owners.empty()) {
+            break;
+        }
+
+        // One forward pass for the leaves of all games
+        network->evaluate(buffers, owners.size());
+        for (std::size_t k = 0; k < owners.size(); ++k) {
+            games[owners[k]].agent->provide_evaluation(buffers.policy(k), buffers.value(k), owners.size(),
+                                                       games.size());
+        }
+        batch_count++;
+        evaluation_count += owners.size();
+    }
+    return games_completed;
+}
+
+int SelfPlayDriver::run_coroutines(std::size_t target_positions) {
+    EvalScheduler scheduler(network, games.size() * simulations_in_flight, search_threads);
+    int games_completed = 0;
+
+    std::vector<GameSlot*> searching;
+    while (true) {
+        // Start the next search of every game, replacing ended games while samples are missing
+        searching.clear();
+        for (GameSlot& game : games) {
+            while (true) {
+                if (!game.active) {
+                    if (dataset.current_size >= target_positions) {
+                        break;
+                    }
+                    start_game(game);
+                }
+                if (game_over(game)) {
+                    finish_game(game);
+                    games_completed++;
+                    continue;
+                }
+                game.agent->spawn_search(scheduler, game.board, game.player, next_search_budget(game),
+                                         simulations_in_flight);
+                game.searching = true;
+                searching.push_back(&game);
+                break;
+            }
+        }
+        if (searching.empty()) {
+            break;
+        }
+
+        scheduler.run();
+        for (GameSlot* game : searching) {
+            play_move(*game);
+        }
+    }
+
+    batch_count += scheduler.batches();
+    evaluation_count += scheduler.evaluations();
+    return games_completed;
+}
+
+double SelfPlayDriver::average_batch_size() const {
+    return batch_count > 0 ? static_cast<double>(evaluation_count) / batch_count : 0.0;
+}
+
+void SelfPlayDriver::start_game(GameSlot& game) {
+    game.board = Board(board_size);
+    game.player = Cell_state::X;
+    game.move_counter = 0;
+    game.active = true;
+    game.searching = false;
+    game.samples.clear();
+
+    // Random opening, as in Game::play
+    for (int move_counter = 0; move_counter < random_opening_moves; ++move_counter) {
+        std::vector<std::array<int, 4>> valid_moves = game.board.get_valid_moves(game.player);
+        if (valid_moves.empty()) {
+            break;
+        }
+        std::uniform_int_distribution<> dist(0, static_cast<int>(valid_moves.size() - 1));
+        const std::array<int, 4>& random_move = valid_moves[dist(random_generator)];
+        game.board.make_move(random_move[0], random_move[1], random_move[2], random_move[3], game.player);
+        if (game.board.check_winner() != Cell_state::Empty) {
+            break;
+        }
+        if (random_move[3] < 1) {
+            game.player = (game.player == Cell_state::X ? Cell_state::O : Cell_state::X);
+            game.board.clear_state();
+        }
+    }
+}
+
+bool SelfPlayDriver::advance(GameSlot& game, EvaluationRequest& request) {
+    while (true) {
+        if (!game.searching) {
+            if (game_over(game)) {
+                finish_game(game);
+                return false;
+            }
+            game.agent->start_search(game.board, game.player, next_search_budget(game));
+            game.searching = true;
+        }
+
+        if (game.agent->advance_search(request)) {
+            return true;
+        }
+        play_move(game);
+    }
+}
+
+bool SelfPlayDriver::game_over(const GameSlot& game) const {
+    return game.board.check_winner() != Cell_state::Empty || game.move_counter > max_moves;
+}
+
+SearchBudget SelfPlayDriver::next_search_budget(GameSlot& game) {
+    // Playout cap randomization: only full searches give policy targets
+    game.full_search = std::bernoulli_distribution(full_search_probability)(random_generator);
+    SearchBudget budget;
+    budget.max_iterations = game.full_search ? full_iterations : cheap_iterations;
+    budget.early_stop = false;
+    budget.root_noise = game.full_search;
+    return budget;
+}
+
+void SelfPlayDriver::play_move(GameSlot& game) {
+    auto [chosen_move, pi] = game.agent->finish_search();
+    game.searching = false;
+    if (game.full_search) {
+        game.samples.push_back(
+            {game.board.to_tensor(game.player), pi, game.board.get_legal_mask(game.player), game.player});
+    }
+
+    game.board.make_move(chosen_move[0], chosen_move[1], chosen_move[2], chosen_move[3], game.player);
+    if (chosen_move[3] < 1) {
+        game.player = (game.player == Cell_state::X ? Cell_state::O : Cell_state::X);
+        game.board.clear_state();
+    }
+    game.move_counter++;
+}
+
+void SelfPlayDriver::finish_game(GameSlot& game) {
+    // Value targets from the point of view of the player to move; a game cut by the move limit is a draw
+    Cell_state winner = game.board.check_winner();
+    for (Sample& sample : game.samples) {
+        float z_value = winner == Cell_state::Empty ? 0.0f : (winner == sample.player ? 1.0f : -1.0f);
+        dataset.add_position(sample.board, sample.pi, torch::tensor(z_value, torch::dtype(torch::kFloat32)),
+                             sample.legal_mask);
+    }
+    game.samples.clear();
+    game.active = false;
+}
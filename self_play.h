@@ -0,0 +1,175 @@
+#ifndef SELF_PLAY_H
+#define SELF_PLAY_H
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "board.h"
+#include "cell_state.h"
+#include "mcts_agent.h"
+#include "nn_model.h"
+#include "rng.h"
+
+/**
+ * @brief Plays many self-play games in one process with batched network evaluations
+ *
+ * Every game owns an Mcts_agent searched step by step (see
+ * Mcts_agent::start_search). A step advances the search of every game until
+ * it needs the network, evaluates all the pending leaves with a single
+ * batched forward pass, and hands each game its result. With hundreds of
+ * games the batch keeps the CPU BLAS busy, where one-position calls leave it
+ * mostly idle.
+ *
+ * With search threads, the searches instead run as coroutines on an
+ * EvalScheduler (see Mcts_agent::spawn_search): every game keeps several
+ * simulations in flight and the threads interleave them while the batches
+ * are evaluated. The games then move in lockstep, one search each per round.
+ *
+ * Games follow the rules of Game::play: a random opening, a move limit, and
+ * playout cap randomization (only full searches become training samples).
+ * Samples are written to the GameDataset when their game ends, with the
+ * value target of the final result.
+ */
+class SelfPlayDriver {
+public:
+    /**
+     * @brief Constructs a driver and the agents of its games
+     *
+     * @param network Network shared by every game
+     * @param dataset Dataset receiving the samples
+     * @param concurrent_games Number of games played at the same time (the batch size)
+     * @param exploration_factor Exploration constant of the PUCT formula
+     * @param full_iterations Simulations of a full search
+     * @param cheap_iterations Simulations of a cheap search (0 for full_iterations / 8)
+     * @param full_search_probability Fraction of the moves searched in full and recorded
+     * @param board_size Size of the game board
+     * @param search_threads Threads running coroutine searches, 0 to step the searches on the calling thread
+     */
+    SelfPlayDriver(std::shared_ptr<NeuralN> network,
+                   GameDataset& dataset,
+                   int concurrent_games,
+                   double exploration_factor,
+                   int full_iterations,
+                   int cheap_iterations = 0,
+                   double full_search_probability = 1.0,
+                   int board_size = 9,
+                   int search_threads = 0);
+
+    /**
+     * @brief Plays games until the dataset holds target_positions positions
+     *
+     * No game is started once the target is reached, but the games in
+     * progress are played to the end so that all their samples get a result.
+     *
+     * @param target_positions Positions wanted in the dataset (at most its capacity)
+     *
+     * @return Number of games completed
+     */
+    int run(std::size_t target_positions);
+
+    /**
+     * @brief Number of batched forward passes run so far
+     */
+    std::size_t batches() const { return batch_count; }
+
+    /**
+     * @brief Mean number of positions per forward pass
+     */
+    double average_batch_size() const;
+
+private:
+    /**
+     * @brief Position searched in full, waiting for the result of its game
+     */
+    struct Sample {
+        torch::Tensor board;
+        torch::Tensor pi;
+        torch::Tensor legal_mask;
+        Cell_state player;
+    };
+
+    /**
+     * @brief One game in progress
+     */
+    struct GameSlot {
+        Board board;
+        Cell_state player;
+        int move_counter;
+        bool active;
+        bool searching;
+        bool full_search;
+        std::unique_ptr<Mcts_agent> agent;
+        std::vector<Sample> samples;
+    };
+
+    static constexpr int max_moves = 70;
+    static constexpr int random_opening_moves = 10;
+
+    /**
+     * @brief Simulations each game keeps waiting for the network in coroutine mode
+     */
+    static constexpr int simulations_in_flight = 8;
+
+    std::shared_ptr<NeuralN> network;
+    GameDataset& dataset;
+    int full_iterations;
+    int cheap_iterations;
+    double full_search_probability;
+    int board_size;
+    int search_threads;
+    std::vector<GameSlot> games;
+    Xoshiro256 random_generator;
+    std::size_t batch_count;
+    std::size_t evaluation_count;
+
+    /**
+     * @brief Steps every search on the calling thread, one leaf per game per batch
+     */
+    int run_stepwise(std::size_t target_positions);
+
+    /**
+     * @brief Runs one coroutine search per game and round on an EvalScheduler
+     */
+    int run_coroutines(std::size_t target_positions);
+
+    /**
+     * @brief Resets a slot to a new game after the random opening
+     */
+    void start_game(GameSlot& game);
+
+    /**
+     * @brief Checks whether a game is won or reached the move limit
+     */
+    bool game_over(const GameSlot& game) const;
+
+    /**
+     * @brief Draws the kind of the next search of a game and returns its budget
+     */
+    SearchBudget next_search_budget(GameSlot& game);
+
+    /**
+     * @brief Searches and plays the moves of a game until it needs the network or ends
+     *
+     * @param game Game to advance
+     * @param request Receives the network input when the game waits for an evaluation
+     *
+     * @return True if request was filled, false once the game is over
+     */
+    bool advance(GameSlot& game, EvaluationRequest& request);
+
+    /**
+     * @brief Plays the move chosen by the finished search of a game, recording full searches
+     */
+    void play_move(GameSlot& game);
+
+    /**
+     * @brief Writes the samples of an ended game to the dataset and frees its slot
+     */
+    void finish_game(GameSlot& game);
+};
+
+#endif // SELF_PLAY_H
@@ -0,0 +1,76 @@
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "cpu_engine.h"
+#include "nn_model.h"
+#include "test_support.h"
+
+namespace {
+
+constexpr float kTolerance = 1e-4f;
+
+/**
+ * @brief CpuInferenceEngine matches FusedAlphaZeroNet::forward on random positions
+ *
+ * Masked moves only have to stay far below the legal ones: their log-probability
+ * is -1e9 shifted by the log normalizer, which floats cannot compare more closely.
+ */
+void check_batch(const FusedAlphaZeroNet& fused, const CpuInferenceEngine& engine, int batch, bool masked) {
+    torch::NoGradGuard no_grad;
+    const torch::Tensor input = torch::randn({batch, 11, 5, 9});
+    torch::Tensor legal_mask;
+    if (masked) {
+        legal_mask = (torch::rand({batch, 1800}) < 0.05).to(torch::kFloat32);
+        legal_mask.select(1, 0).fill_(1.0f);  // At least one legal move per position
+    }
+    auto [reference_policy, reference_value] = fused.forward(input, legal_mask);
+
+    std::vector<float> policy(static_cast<std::size_t>(batch) * 1800);
+    std::vector<float> value(batch);
+    engine.evaluate(input.data_ptr<float>(), masked ? legal_mask.data_ptr<float>() : nullptr, batch, policy.data(),
+                    value.data());
+    const torch::Tensor engine_policy = torch::from_blob(policy.data(), {batch, 1800});
+    const torch::Tensor engine_value = torch::from_blob(value.data(), {batch});
+
+    CHECK((engine_value - reference_value).abs().max().item<float>() < kTolerance);
+    if (!masked) {
+        CHECK((engine_policy - reference_policy).abs().max().item<float>() < kTolerance);
+        return;
+    }
+    const torch::Tensor legal = legal_mask != 0;
+    const torch::Tensor illegal = legal_mask == 0;
+    CHECK((engine_policy - reference_policy).abs().masked_select(legal).max().item<float>() < kTolerance);
+    CHECK(engine_policy.masked_select(illegal).max().item<float>() < -1e8f);
+    CHECK(reference_policy.masked_select(illegal).max().item<float>() < -1e8f);
+}
+
+}  // namespace
+
+int main() {
+    torch::manual_seed(0);
+    AlphaZeroNetWithMask model;
+    {
+        // Non-trivial running statistics, so that the BatchNorm folding is exercised
+        torch::NoGradGuard no_grad;
+        for (auto& buffer : model->named_buffers()) {
+            const std::string& name = buffer.key();
+            if (name.ends_with("running_mean")) {
+                buffer.value().uniform_(-0.5, 0.5);
+            } else if (name.ends_with("running_var")) {
+                buffer.value().uniform_(0.5, 2.0);
+            }
+        }
+    }
+    model->eval();
+
+    const FusedAlphaZeroNet fused(*model, torch::kCPU);
+    const CpuInferenceEngine engine(fused.export_weights());
+    for (int batch : {1, 3, 16}) {
+        check_batch(fused, engine, batch, true);
+        check_batch(fused, engine, batch, false);
+    }
+    return test_result();
+}
@@ -0,0 +1,76 @@
+#include "eval_cache.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mcts_agent.h"
+#include "nn_model.h"
+#include "test_support.h"
+
+namespace {
+
+using Policy = std::vector<std::pair<std::uint16_t, float>>;
+
+constexpr std::uint64_t position_key = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * @brief Entries are only returned to the network generation that stored them
+ */
+void check_generations(EvalCache& cache) {
+    const Policy policy{{3, 0.25f}, {17, 0.75f}};
+    float value = 0.0f;
+    Policy cached;
+
+    cache.store(position_key, 1, 0.5f, policy);
+    CHECK(cache.lookup(position_key, 1, value, cached));
+    CHECK(value == 0.5f);
+    CHECK(cached == policy);
+    CHECK(!cache.lookup(position_key, 2, value, cached));
+
+    // The other generation takes the slot over
+    cache.store(position_key, 2, -0.25f, policy);
+    CHECK(cache.lookup(position_key, 2, value, cached));
+    CHECK(value == -0.25f);
+    CHECK(!cache.lookup(position_key, 1, value, cached));
+}
+
+/**
+ * @brief A new network, or a new inference mode of the same one, does not see the previous entries
+ */
+void check_network_swap(EvalCache& cache) {
+    const std::string path = (std::filesystem::temp_directory_path() / "fanorona_test_eval_cache.pt").string();
+    AlphaZeroNetWithMask model;
+    model->save_model(path);
+
+    NeuralN first(path);
+    NeuralN second(path);
+    CHECK(first.generation() != second.generation());
+
+    const Policy policy{{5, 1.0f}};
+    float value = 0.0f;
+    Policy cached;
+    cache.store(position_key, first.generation(), 0.75f, policy);
+    CHECK(cache.lookup(position_key, first.generation(), value, cached));
+    CHECK(!cache.lookup(position_key, second.generation(), value, cached));
+
+    const std::uint64_t fp32 = first.generation();
+    first.enable_cpu_engine();
+    CHECK(first.generation() != fp32);
+    CHECK(!cache.lookup(position_key, first.generation(), value, cached));
+    first.disable_cpu_engine();
+    CHECK(first.generation() != fp32);
+
+    std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+    EvalCache cache(std::size_t(1) << 20);
+    check_generations(cache);
+    check_network_swap(cache);
+    return test_result();
+}
@@ -0,0 +1,100 @@
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "board.h"
+#include "eval_scheduler.h"
+#include "mcts_agent.h"
+#include "nn_model.h"
+#include "test_support.h"
+
+namespace {
+
+/**
+ * @brief Network whose forward passes fail once a few batches have been evaluated
+ */
+class FailingNetwork : public NeuralN {
+public:
+    FailingNetwork(const std::string& model_path, int good_batches) : NeuralN(model_path), good_batches(good_batches) {}
+
+    void evaluate(InferenceBuffers& buffers, std::size_t batch) override {
+        if (good_batches.fetch_sub(1) <= 0) {
+            throw std::runtime_error("forward pass failed");
+        }
+        NeuralN::evaluate(buffers, batch);
+    }
+
+private:
+    std::atomic<int> good_batches;
+};
+
+/**
+ * @brief A failing forward pass ends run() with its exception instead of leaving simulations waiting
+ */
+void check_failure(const std::string& model_path, int good_batches, int num_threads) {
+    auto network = std::make_shared<FailingNetwork>(model_path, good_batches);
+    EvalScheduler scheduler(network, 8, num_threads);
+    Mcts_agent first(network, 1.4, 200);
+    Mcts_agent second(network, 1.4, 200);
+
+    SearchBudget budget;
+    budget.max_iterations = 200;
+    budget.early_stop = false;
+    first.spawn_search(scheduler, Board(9), Cell_state::X, budget, 16);
+    second.spawn_search(scheduler, Board(9), Cell_state::O, budget, 16);
+
+    bool failed = false;
+    try {
+        scheduler.run();
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    CHECK(failed);
+}
+
+/**
+ * @brief Simulations in flight together run exactly the iteration budget
+ */
+void check_budget(const std::shared_ptr<NeuralN>& network, int iterations, int in_flight) {
+    EvalScheduler scheduler(network, 8, 2);
+    Mcts_agent agent(network, 1.4, iterations);
+
+    SearchBudget budget;
+    budget.max_iterations = iterations;
+    budget.early_stop = false;
+    agent.spawn_search(scheduler, Board(9), Cell_state::X, budget, in_flight);
+    scheduler.run();
+    agent.finish_search();
+
+    CHECK(agent.last_search_stats().simulations == iterations);
+}
+
+}  // namespace
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string model_path = (directory / "fanorona_test_scheduler.pt").string();
+    AlphaZeroNetWithMask model;
+    model->save_model(model_path);
+
+    // Failures of the root evaluations and of batches with simulations waiting on their leaves
+    for (int good_batches : {0, 1, 2, 5}) {
+        for (int num_threads : {1, 3}) {
+            check_failure(model_path, good_batches, num_threads);
+        }
+    }
+
+    // Budgets smaller than, and not a multiple of, the simulations in flight
+    auto network = std::make_shared<NeuralN>(model_path);
+    for (int iterations : {3, 50, 101}) {
+        for (int in_flight : {1, 8, 16}) {
+            check_budget(network, iterations, in_flight);
+        }
+    }
+
+    std::filesystem::remove(model_path);
+    return test_result();
+}
@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "board.h"
+#include "mcts_agent.h"
+#include "nn_model.h"
+#include "test_support.h"
+#include "tree_dump.h"
+
+namespace {
+
+/**
+ * @brief Sum of the visit counts of the root edges of a tree dump
+ */
+std::int64_t root_visits(const std::string& path) {
+    TreeDumpReader reader(path);
+    const std::uint32_t root = reader.header().root;
+    TreeDumpNode node;
+    TreeDumpNode root_node{};
+    for (std::uint32_t index = 0; reader.next_node(node); ++index) {
+        if (index == root) {
+            root_node = node;
+        }
+    }
+    TreeDumpEdge edge;
+    std::int64_t visits = 0;
+    for (std::uint32_t index = 0; reader.next_edge(edge); ++index) {
+        if (index >= root_node.first_edge && index < root_node.first_edge + root_node.num_edges) {
+            visits += edge.visit_count;
+        }
+    }
+    return visits;
+}
+
+/**
+ * @brief A Gumbel root search spends its whole iteration budget at the root
+ */
+void check_budget(const std::shared_ptr<NeuralN>& network, const std::string& dump_path, int iterations,
+                  int gumbel_actions) {
+    Mcts_agent agent(network, 1.4, iterations);
+    agent.set_tree_export(dump_path);
+
+    SearchBudget budget;
+    budget.max_iterations = iterations;
+    budget.early_stop = false;
+    budget.gumbel_root = true;
+    budget.gumbel_actions = gumbel_actions;
+    agent.choose_move(Board(9), Cell_state::X, budget);
+
+    CHECK(agent.last_search_stats().simulations == iterations);
+    CHECK(root_visits(dump_path) == iterations);
+}
+
+}  // namespace
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string model_path = (directory / "fanorona_test_gumbel.pt").string();
+    const std::string dump_path = (directory / "fanorona_test_gumbel.tree").string();
+    AlphaZeroNetWithMask model;
+    model->save_model(model_path);
+    auto network = std::make_shared<NeuralN>(model_path);
+
+    // Budgets that do not divide evenly between the rounds and candidates
+    for (int iterations : {7, 50, 200}) {
+        for (int gumbel_actions : {1, 3, 16}) {
+            check_budget(network, dump_path, iterations, gumbel_actions);
+        }
+    }
+
+    std::filesystem::remove(model_path);
+    std::filesystem::remove(dump_path);
+    return test_result();
+}
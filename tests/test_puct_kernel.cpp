@@ -0,0 +1,85 @@
+#include "puct_kernel.h"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "test_support.h"
+
+namespace {
+
+/**
+ * @brief Checks that the vectorized and the scalar selections agree on one set of children
+ */
+void check_same_choice(const std::vector<float>& priors, const std::vector<std::int32_t>& visits,
+                       const std::vector<float>& value_sums, float c_sqrt_n) {
+    const auto count = static_cast<std::uint32_t>(priors.size());
+    float vector_score = 0.0f;
+    float scalar_score = 0.0f;
+    std::uint32_t vector_index =
+        select_puct_child(priors.data(), visits.data(), value_sums.data(), count, c_sqrt_n, vector_score);
+    std::uint32_t scalar_index =
+        select_puct_child_scalar(priors.data(), visits.data(), value_sums.data(), count, c_sqrt_n, scalar_score);
+    CHECK(vector_index == scalar_index);
+    CHECK(vector_score == scalar_score);
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<std::int32_t> visit_dist(0, 50);
+
+    // Every count around the 8 and 16 lane widths, with and without unvisited children
+    for (std::uint32_t count = 1; count <= 70; ++count) {
+        for (int round = 0; round < 20; ++round) {
+            std::vector<float> priors(count);
+            std::vector<std::int32_t> visits(count);
+            std::vector<float> value_sums(count);
+            for (std::uint32_t i = 0; i < count; ++i) {
+                priors[i] = unit(rng);
+                visits[i] = round % 4 == 0 ? 0 : visit_dist(rng);
+                value_sums[i] = visits[i] * (2.0f * unit(rng) - 1.0f);
+            }
+            check_same_choice(priors, visits, value_sums, 1.5f * unit(rng) + 0.1f);
+        }
+    }
+
+    // Equal scores everywhere: both pick the first child
+    for (std::uint32_t count : {1u, 7u, 8u, 9u, 16u, 17u, 33u}) {
+        std::vector<float> priors(count, 0.25f);
+        std::vector<std::int32_t> visits(count, 3);
+        std::vector<float> value_sums(count, 1.5f);
+        check_same_choice(priors, visits, value_sums, 1.0f);
+        float score = 0.0f;
+        CHECK(select_puct_child(priors.data(), visits.data(), value_sums.data(), count, 1.0f, score) == 0);
+    }
+
+    // Ties between two children in different lanes: the lower index wins
+    {
+        std::vector<float> priors(40, 0.1f);
+        std::vector<std::int32_t> visits(40, 0);
+        std::vector<float> value_sums(40, 0.0f);
+        priors[21] = 0.9f;
+        priors[37] = 0.9f;
+        check_same_choice(priors, visits, value_sums, 1.0f);
+        float score = 0.0f;
+        CHECK(select_puct_child(priors.data(), visits.data(), value_sums.data(), 40, 1.0f, score) == 21);
+    }
+
+    // Proven children carry infinite value sums
+    {
+        std::vector<float> priors(24, 0.5f);
+        std::vector<std::int32_t> visits(24, 2);
+        std::vector<float> value_sums(24, 0.0f);
+        value_sums[3] = -std::numeric_limits<float>::infinity();
+        value_sums[18] = std::numeric_limits<float>::infinity();
+        check_same_choice(priors, visits, value_sums, 1.0f);
+        float score = 0.0f;
+        CHECK(select_puct_child(priors.data(), visits.data(), value_sums.data(), 24, 1.0f, score) == 18);
+    }
+
+    return test_result();
+}
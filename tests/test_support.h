@@ -0,0 +1,37 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * @brief Number of failed checks of the running test executable
+ */
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+/**
+ * @brief Records a failure, with its location, when a condition does not hold
+ */
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            ++test_failures();                                                            \
+        }                                                                                 \
+    } while (false)
+
+/**
+ * @brief Exit status of a test executable: non-zero if any check failed
+ */
+inline int test_result() {
+    if (test_failures() != 0) {
+        std::cerr << test_failures() << " check(s) failed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+#endif // TEST_SUPPORT_H
@@ -0,0 +1,142 @@
+#include "thread_config.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include <torch/torch.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Written by configure_threads at startup, read-only once search threads run
+std::vector<int> search_cpus;
+bool pin_search = false;
+int inter_op_configured = 0;
+
+int parse_int(const std::string& text, const std::string& what) {
+    std::size_t end = 0;
+    int value = 0;
+    try {
+        value = std::stoi(text, &end);
+    } catch (const std::exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != text.size() || value < 0) {
+        throw std::runtime_error("Invalid " + what + ": \"" + text + "\"");
+    }
+    return value;
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+}  // namespace
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t comma = list.find(',', start);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        const std::string item = list.substr(start, comma - start);
+        const std::size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            cpus.push_back(parse_int(item, "CPU"));
+        } else {
+            const int first = parse_int(item.substr(0, dash), "CPU");
+            const int last = parse_int(item.substr(dash + 1), "CPU");
+            if (last < first) {
+                throw std::runtime_error("Invalid CPU range: \"" + item + "\"");
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        start = comma + 1;
+    }
+    return cpus;
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+void configure_threads(const ThreadConfig& config) {
+    if (!pin_current_thread(config.cpus)) {
+        throw std::runtime_error("Cannot run on the requested CPUs");
+    }
+
+    const int intra_op = config.intra_op_threads > 0 ? config.intra_op_threads
+                                                     : static_cast<int>(config.cpus.size());
+    if (intra_op > 0) {
+        torch::set_num_threads(intra_op);
+    }
+    if (config.inter_op_threads > 0 && config.inter_op_threads != inter_op_configured) {
+        // libtorch sizes the inter-op pool once, before its first use
+        if (inter_op_configured != 0) {
+            throw std::runtime_error("The inter-op thread pool is already configured");
+        }
+        torch::set_num_interop_threads(config.inter_op_threads);
+        inter_op_configured = config.inter_op_threads;
+    }
+
+    pin_search = config.pin_search_threads;
+    search_cpus = config.cpus.empty() ? allowed_cpus() : config.cpus;
+}
+
+ThreadConfig thread_config_from_env() {
+    ThreadConfig config;
+    if (const char* cpus = std::getenv("FANORONA_CPUS")) {
+        config.cpus = parse_cpu_list(cpus);
+    }
+    if (const char* threads = std::getenv("FANORONA_INTRA_OP_THREADS")) {
+        config.intra_op_threads = parse_int(threads, "FANORONA_INTRA_OP_THREADS");
+    }
+    if (const char* threads = std::getenv("FANORONA_INTER_OP_THREADS")) {
+        config.inter_op_threads = parse_int(threads, "FANORONA_INTER_OP_THREADS");
+    }
+    if (const char* pin = std::getenv("FANORONA_PIN_SEARCH")) {
+        config.pin_search_threads = parse_int(pin, "FANORONA_PIN_SEARCH") != 0;
+    }
+    return config;
+}
+
+void pin_search_thread(std::size_t index) {
+    if (pin_search && !search_cpus.empty()) {
+        pin_current_thread({search_cpus[index % search_cpus.size()]});
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef THREAD_CONFIG_H
+#define THREAD_CONFIG_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Thread pools and CPU placement of the process
+ *
+ * libtorch keeps one intra-op and one inter-op pool per process, shared by
+ * every NeuralN, so the configuration is per process: when several
+ * self-play processes share a machine, each gets its own CPU set and pool
+ * sizes that fit in it instead of one pool per core each.
+ */
+struct ThreadConfig {
+    /**
+     * @brief Threads of one forward pass (0: libtorch default, or the size of cpus when set)
+     */
+    int intra_op_threads = 0;
+
+    /**
+     * @brief Threads running independent operators concurrently (0: libtorch default)
+     */
+    int inter_op_threads = 0;
+
+    /**
+     * @brief CPUs the process runs on (empty: no restriction)
+     */
+    std::vector<int> cpus;
+
+    /**
+     * @brief Pins each search thread to one CPU of the set, round robin
+     */
+    bool pin_search_threads = false;
+};
+
+/**
+ * @brief Applies a configuration to the process
+ *
+ * Restricts the calling thread to config.cpus; the threads created
+ * afterwards, libtorch pools included, inherit the restriction. Must be
+ * called from the main thread at startup, before any inference and before
+ * search threads start.
+ *
+ * @param config Configuration to apply
+ *
+ * @throws std::runtime_error if the CPU set cannot be applied or the inter-op pool already started with another size
+ */
+void configure_threads(const ThreadConfig& config);
+
+/**
+ * @brief Reads a configuration from the environment
+ *
+ * FANORONA_CPUS (CPU list such as "0-3,8"), FANORONA_INTRA_OP_THREADS,
+ * FANORONA_INTER_OP_THREADS and FANORONA_PIN_SEARCH (1 to pin the search
+ * threads). Unset variables keep the defaults.
+ *
+ * @throws std::runtime_error if a variable cannot be parsed
+ */
+ThreadConfig thread_config_from_env();
+
+/**
+ * @brief Parses a CPU list such as "0-3,8,10-11"
+ *
+ * @throws std::runtime_error if the list is malformed
+ */
+std::vector<int> parse_cpu_list(const std::string& list);
+
+/**
+ * @brief Restricts the calling thread to a set of CPUs
+ *
+ * @param cpus CPUs allowed (empty: nothing is changed)
+ *
+ * @return false if the set could not be applied (or pinning is not supported on this platform)
+ */
+bool pin_current_thread(const std::vector<int>& cpus);
+
+/**
+ * @brief Pins the calling search thread if the configuration asks for it
+ *
+ * Search threads created by the agents and the evaluation scheduler call
+ * this with their index; thread i runs on CPU i modulo the size of the set.
+ *
+ * @param index Index of the thread among the search threads
+ */
+void pin_search_thread(std::size_t index);
+
+#endif // THREAD_CONFIG_H
@@ -0,0 +1,197 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Ring of the current thread, valid while writer_id names the live writer
+ *
+ * Shares the ring with the writer, so it can be released even after the
+ * writer is gone.
+ */
+struct LocalRing {
+    std::uint64_t writer_id = 0;
+    std::shared_ptr<TraceRing> ring;
+
+    void reset(std::uint64_t writer, std::shared_ptr<TraceRing> next) {
+        if (ring) {
+            ring->release();
+        }
+        writer_id = writer;
+        ring = std::move(next);
+    }
+
+    // The thread exits: its ring goes back to the writer
+    ~LocalRing() { reset(0, nullptr); }
+};
+
+thread_local LocalRing local_ring_cache;
+
+// Writers get distinct ids so that a new writer is never mistaken for a destroyed one
+std::atomic<std::uint64_t> next_writer_id{1};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+}  // namespace
+
+TraceRing::TraceRing(std::size_t capacity, std::uint16_t thread)
+    : thread(thread),
+      slots(std::bit_ceil(std::max<std::size_t>(2, capacity))),
+      mask(slots.size() - 1),
+      head(0),
+      tail(0),
+      drop_count(0),
+      released(false) {}
+
+bool TraceRing::push(const TraceEvent& event) {
+    const std::uint64_t position = head.load(std::memory_order_relaxed);
+    if (position - tail.load(std::memory_order_acquire) > mask) {
+        drop_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    slots[position & mask] = event;
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void TraceRing::drain(std::vector<TraceEvent>& out) {
+    const std::uint64_t begin = tail.load(std::memory_order_relaxed);
+    const std::uint64_t end = head.load(std::memory_order_acquire);
+    for (std::uint64_t position = begin; position < end; ++position) {
+        out.push_back(slots[position & mask]);
+    }
+    tail.store(end, std::memory_order_release);
+}
+
+TraceWriter::TraceWriter(const std::string& path, std::size_t ring_capacity)
+    : id(next_writer_id.fetch_add(1, std::memory_order_relaxed)),
+      ring_capacity(ring_capacity),
+      file(path, std::ios::binary | std::ios::trunc),
+      stopping(false) {
+    if (!file) {
+        throw std::runtime_error("Cannot create the trace file " + path);
+    }
+    const std::uint32_t event_size = sizeof(TraceEvent);
+    file.write(magic, sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&event_size), sizeof(event_size));
+
+    writer = std::thread([this]() { run(); });
+}
+
+TraceWriter::~TraceWriter() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_signal.notify_one();
+    writer.join();
+
+    std::vector<TraceEvent> buffer;
+    write_pending(buffer);
+
+    // Rings still held by live threads are released by them; only their counts are read here
+    std::uint64_t dropped = 0;
+    for (const auto& ring : rings) {
+        dropped += ring->dropped();
+    }
+    if (dropped > 0) {
+        TraceEvent event{};
+        event.timestamp_ns = now_ns();
+        event.type = TraceEventType::Dropped;
+        event.numbers.counts[0] = static_cast<std::int64_t>(dropped);
+        file.write(reinterpret_cast<const char*>(&event), sizeof(event));
+    }
+    file.flush();
+}
+
+void TraceWriter::record(TraceEvent event) {
+    TraceRing& ring = local_ring();
+    event.timestamp_ns = now_ns();
+    event.thread = ring.thread;
+    ring.push(event);
+}
+
+TraceRing& TraceWriter::local_ring() {
+    if (local_ring_cache.writer_id != id) {
+        std::shared_ptr<TraceRing> ring;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            if (!free_rings.empty()) {
+                ring = std::move(free_rings.back());
+                free_rings.pop_back();
+            } else {
+                // Thread identifiers are 16 bits in the events
+                if (rings.size() > std::numeric_limits<std::uint16_t>::max()) {
+                    throw std::runtime_error("Too many threads recording trace events");
+                }
+                ring = std::make_shared<TraceRing>(ring_capacity, static_cast<std::uint16_t>(rings.size()));
+                rings.push_back(ring);
+            }
+        }
+        local_ring_cache.reset(id, std::move(ring));
+    }
+    return *local_ring_cache.ring;
+}
+
+void TraceWriter::run() {
+    std::vector<TraceEvent> buffer;
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stopping) {
+        stop_signal.wait_for(lock, std::chrono::milliseconds(1));
+        lock.unlock();
+        write_pending(buffer);
+        lock.lock();
+    }
+}
+
+void TraceWriter::write_pending(std::vector<TraceEvent>& buffer) {
+    buffer.clear();
+    {
+        // Only registrations contend for this lock, never the producers' pushes
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (const auto& ring : rings) {
+            // A ring released before this drain holds no more events afterwards
+            const bool released = ring->take_released();
+            ring->drain(buffer);
+            if (released) {
+                free_rings.push_back(ring);
+            }
+        }
+    }
+    if (buffer.empty()) {
+        return;
+    }
+    // Each ring is in order; interleave the threads by time
+    std::stable_sort(buffer.begin(), buffer.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+    file.write(reinterpret_cast<const char*>(buffer.data()),
+               static_cast<std::streamsize>(buffer.size() * sizeof(TraceEvent)));
+}
+
+TraceReader::TraceReader(const std::string& path) : file(path, std::ios::binary) {
+    if (!file) {
+        throw std::runtime_error("Cannot open the trace file " + path);
+    }
+    char header[sizeof(TraceWriter::magic)];
+    std::uint32_t event_size = 0;
+    file.read(header, sizeof(header));
+    file.read(reinterpret_cast<char*>(&event_size), sizeof(event_size));
+    if (!file || std::memcmp(header, TraceWriter::magic, sizeof(header)) != 0 || event_size != sizeof(TraceEvent)) {
+        throw std::runtime_error(path + " is not a trace file of this build");
+    }
+}
+
+bool TraceReader::next(TraceEvent& event) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&event), sizeof(event)));
+}
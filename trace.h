@@ -0,0 +1,229 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Kind of a trace event, one per Logger message
+ */
+enum class TraceEventType : std::uint8_t {
+    MctsStart,
+    MctsEnd,
+    IterationNumber,
+    Step,
+    NnEvaluation,
+    Expansion,
+    SelectedChild,
+    PuctDetails,
+    SimulationStart,
+    SimulationStep,
+    SimulationEnd,
+    BackpropagationStart,
+    BackpropagationResult,
+    RootStats,
+    ChildNodeStats,
+    CacheStats,
+    TimerRanOut,
+    BestChildChosen,
+    DirichletNoiseApplied,
+    Dropped  // Events lost because a ring was full
+};
+
+/**
+ * @brief Numeric arguments of a trace event; their meaning depends on the type
+ */
+struct TraceNumbers {
+    double score;
+    std::int64_t counts[2];
+    float values[3];
+};
+
+/**
+ * @brief Fixed-size binary record of one Logger message
+ *
+ * Holds the arguments of the message rather than its text: formatting is
+ * left to the decoder (see Logger::format_event). Events are written to the
+ * trace file as raw bytes.
+ */
+struct TraceEvent {
+    std::uint64_t timestamp_ns;
+    TraceEventType type;
+    std::uint8_t player;
+    std::uint16_t thread;
+    std::array<std::int8_t, 4> move;
+    union {
+        TraceNumbers numbers;
+        char label[sizeof(TraceNumbers)];  // Step name, truncated and null-terminated
+    };
+};
+
+static_assert(std::is_trivially_copyable_v<TraceEvent>, "trace events are written as raw bytes");
+
+/**
+ * @brief Single-producer single-consumer ring of trace events
+ *
+ * Owned by one search thread (the producer) and drained by the trace writer.
+ * Neither side takes a lock; a full ring drops the event and counts it
+ * instead of blocking the search. When its thread exits, the ring is
+ * released and, once drained, handed to the next thread that records.
+ */
+class TraceRing {
+public:
+    /**
+     * @brief Constructs an empty ring
+     *
+     * @param capacity Number of events, rounded up to a power of two
+     * @param thread Identifier written in the events of the owning thread
+     */
+    TraceRing(std::size_t capacity, std::uint16_t thread);
+
+    /**
+     * @brief Appends an event; called by the owning thread only
+     *
+     * @return false if the ring was full and the event was dropped
+     */
+    bool push(const TraceEvent& event);
+
+    /**
+     * @brief Moves the pending events to the end of out; called by the writer only
+     */
+    void drain(std::vector<TraceEvent>& out);
+
+    /**
+     * @brief Gives the ring up; called by the owning thread after its last push
+     */
+    void release() { released.store(true, std::memory_order_release); }
+
+    /**
+     * @brief Checks whether the owner gave the ring up, and clears the mark; called by the writer only
+     *
+     * Every event pushed before release is visible to a drain that follows.
+     */
+    bool take_released() { return released.exchange(false, std::memory_order_acquire); }
+
+    /**
+     * @brief Number of events dropped so far
+     */
+    std::uint64_t dropped() const { return drop_count.load(std::memory_order_relaxed); }
+
+    const std::uint16_t thread;
+
+private:
+    std::vector<TraceEvent> slots;
+    std::uint64_t mask;
+    alignas(64) std::atomic<std::uint64_t> head;  // Next slot written by the producer
+    alignas(64) std::atomic<std::uint64_t> tail;  // Next slot read by the writer
+    std::atomic<std::uint64_t> drop_count;
+    std::atomic<bool> released;
+};
+
+/**
+ * @brief Background writer of a binary trace file
+ *
+ * Every thread recording events gets its own TraceRing on its first event,
+ * reusing the ring of a thread that exited when one is free, so the number
+ * of rings is bounded by the number of threads recording at the same time
+ * (the events of a reused ring keep its thread identifier). A writer thread
+ * wakes up every millisecond, drains the rings, orders the events by time
+ * and appends them to the file. The search threads only copy an event into
+ * their ring.
+ *
+ * The file starts with the 8 bytes "FNTRACE1" and the size of an event
+ * (uint32), followed by the raw TraceEvent records.
+ */
+class TraceWriter {
+public:
+    /**
+     * @brief Opens the trace file and starts the writer thread
+     *
+     * @param path File to create
+     * @param ring_capacity Events buffered per thread between two drains
+     *
+     * @throws std::runtime_error if the file cannot be created
+     */
+    explicit TraceWriter(const std::string& path, std::size_t ring_capacity = 1 << 14);
+
+    /**
+     * @brief Writes the remaining events, then a Dropped event if any were lost, and closes the file
+     *
+     * No thread may record events anymore.
+     */
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /**
+     * @brief Timestamps an event and queues it in the ring of the calling thread
+     *
+     * @throws std::runtime_error if the calling thread needs a new ring and 65536 threads already record
+     */
+    void record(TraceEvent event);
+
+    static constexpr char magic[8] = {'F', 'N', 'T', 'R', 'A', 'C', 'E', '1'};
+
+private:
+    const std::uint64_t id;
+    const std::size_t ring_capacity;
+    std::ofstream file;
+
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<TraceRing>> rings;
+    std::vector<std::shared_ptr<TraceRing>> free_rings;  // Released and drained
+
+    std::mutex stop_mutex;
+    std::condition_variable stop_signal;
+    bool stopping;
+    std::thread writer;
+
+    /**
+     * @brief Ring of the calling thread, taken on its first event from the free rings or created
+     */
+    TraceRing& local_ring();
+
+    /**
+     * @brief Loop of the writer thread
+     */
+    void run();
+
+    /**
+     * @brief Drains every ring and appends the events to the file in time order
+     */
+    void write_pending(std::vector<TraceEvent>& buffer);
+};
+
+/**
+ * @brief Streaming reader of a trace file
+ */
+class TraceReader {
+public:
+    /**
+     * @brief Opens a trace file and checks its header
+     *
+     * @throws std::runtime_error if the file is missing or not a trace of this build
+     */
+    explicit TraceReader(const std::string& path);
+
+    /**
+     * @brief Reads the next event
+     *
+     * @return false at the end of the file
+     */
+    bool next(TraceEvent& event);
+
+private:
+    std::ifstream file;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,37 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "logger.h"
+#include "trace.h"
+
+/**
+ * @brief Prints a binary trace written by Logger::start_trace.
+ *
+ * Usage: fanorona_trace <trace file> [--threads]
+ *
+ * Messages are printed in the format of the console Logger, in time order.
+ * With --threads each message is prefixed by the search thread that logged it.
+ */
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <trace file> [--threads]\n";
+    return 1;
+  }
+  const bool show_threads = argc > 2 && std::string(argv[2]) == "--threads";
+
+  try {
+    TraceReader reader(argv[1]);
+    TraceEvent event;
+    while (reader.next(event)) {
+      if (show_threads && event.type != TraceEventType::Dropped) {
+        std::cout << "[T" << event.thread << "] ";
+      }
+      std::cout << Logger::format_event(event) << '\n';
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,134 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "node_arena.h"
+
+/**
+ * @brief Lock-free map from position hash to search node
+ *
+ * Lets the search share one node between all move orders reaching the same
+ * position, turning the tree into a directed acyclic graph. Open addressing
+ * with linear probing over a power-of-two table sized for twice the node
+ * capacity; keys are claimed with a compare-and-swap, so several search
+ * threads may insert concurrently. Entries are never removed individually:
+ * the table is cleared together with the node arena.
+ */
+class TranspositionTable {
+public:
+    /**
+     * @brief Constructs a table for up to max_nodes nodes
+     *
+     * @param max_nodes Capacity of the node arena the table indexes
+     */
+    explicit TranspositionTable(std::size_t max_nodes = 0) {
+        std::size_t size = 1;
+        while (size < 2 * max_nodes) {
+            size <<= 1;
+        }
+        slots = std::make_unique<Slot[]>(size);
+        mask = size - 1;
+        clear();
+    }
+
+    /**
+     * @brief Node of a position
+     *
+     * @param key Hash of the position
+     *
+     * @return Node of the position, or kNullNode if it is not in the table
+     */
+    NodeIndex find(std::uint64_t key) const {
+        key = non_zero(key);
+        for (std::size_t probe = 0, i = key & mask; probe <= mask; ++probe, i = (i + 1) & mask) {
+            std::uint64_t slot_key = slots[i].key.load(std::memory_order_acquire);
+            if (slot_key == key) {
+                return wait_for_node(slots[i]);
+            }
+            if (slot_key == 0) {
+                return kNullNode;
+            }
+        }
+        return kNullNode;
+    }
+
+    /**
+     * @brief Maps a position to a node unless it is already mapped
+     *
+     * @param key Hash of the position
+     * @param node Fully initialized node for the position
+     *
+     * @return The node now mapped to the position: node, or the one inserted
+     *         first by another thread. node is returned unmapped if the table is full.
+     */
+    NodeIndex insert(std::uint64_t key, NodeIndex node) {
+        key = non_zero(key);
+        for (std::size_t probe = 0, i = key & mask; probe <= mask; ++probe, i = (i + 1) & mask) {
+            std::uint64_t slot_key = slots[i].key.load(std::memory_order_acquire);
+            if (slot_key == 0 &&
+                slots[i].key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel)) {
+                slots[i].node.store(node, std::memory_order_release);
+                return node;
+            }
+            if (slot_key == key) {
+                return wait_for_node(slots[i]);
+            }
+        }
+        return node;
+    }
+
+    /**
+     * @brief Worst-case table memory per node of capacity (the size is rounded up to a power of two)
+     */
+    static constexpr std::size_t bytes_per_node() { return 4 * sizeof(Slot); }
+
+    /**
+     * @brief Removes every entry, must not race with lookups or insertions
+     */
+    void clear() {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            slots[i].key.store(0, std::memory_order_relaxed);
+            slots[i].node.store(kNullNode, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Exchanges the contents of two tables, must not race with lookups or insertions
+     */
+    void swap(TranspositionTable& other) {
+        slots.swap(other.slots);
+        std::swap(mask, other.mask);
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> key;
+        std::atomic<NodeIndex> node;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask;
+
+    /**
+     * @brief Key 0 marks empty slots, so it is folded onto 1
+     */
+    static std::uint64_t non_zero(std::uint64_t key) { return key == 0 ? 1 : key; }
+
+    /**
+     * @brief Node of a claimed slot, waiting for the inserting thread to publish it
+     */
+    static NodeIndex wait_for_node(const Slot& slot) {
+        NodeIndex node;
+        while ((node = slot.node.load(std::memory_order_acquire)) == kNullNode) {
+            std::this_thread::yield();
+        }
+        return node;
+    }
+};
+
+#endif // TRANSPOSITION_TABLE_H
@@ -0,0 +1,118 @@
+#include "tree_dump.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "board.h"
+#include "logger.h"
+
+namespace {
+
+constexpr std::uint32_t kNoChild = std::numeric_limits<std::uint32_t>::max();
+
+void print_children(const std::vector<TreeDumpNode>& nodes, const std::vector<TreeDumpEdge>& edges,
+                    std::uint32_t node, int depth, int top_n, int max_depth, std::ostream& out) {
+    const TreeDumpNode& parent = nodes[node];
+    std::vector<std::uint32_t> order(parent.num_edges);
+    for (std::uint32_t i = 0; i < parent.num_edges; ++i) {
+        order[i] = parent.first_edge + i;
+    }
+    const std::size_t shown = std::min<std::size_t>(order.size(), std::max(0, top_n));
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return edges[a].visit_count > edges[b].visit_count;
+    });
+
+    for (std::size_t i = 0; i < shown; ++i) {
+        const TreeDumpEdge& edge = edges[order[i]];
+        if (edge.visit_count == 0) {
+            break;
+        }
+        out << std::string(2 * depth, ' ') << Logger::print_move(Board::index_to_move(edge.move_index))
+            << " | Visits: " << edge.visit_count
+            << " | Prior: " << std::fixed << std::setprecision(3) << edge.prior
+            << " | Mean Value: " << std::setprecision(3) << edge.value_sum / edge.visit_count;
+        if (edge.child != kNoChild && edge.child < nodes.size()) {
+            const TreeDumpNode& child = nodes[edge.child];
+            if (child.expanded) {
+                out << " | NN Value: " << std::setprecision(3) << child.value_from_nn;
+            }
+            if (child.proof != 0) {
+                out << (child.proof == 1 ? " | proven win" : " | proven loss");
+            }
+        }
+        out << "\n";
+
+        if (depth < max_depth && edge.child != kNoChild && edge.child < nodes.size()) {
+            print_children(nodes, edges, edge.child, depth + 1, top_n, max_depth, out);
+        }
+    }
+}
+
+}  // namespace
+
+TreeDumpReader::TreeDumpReader(const std::string& path) : file(path, std::ios::binary), nodes_read(0), edges_read(0) {
+    if (!file) {
+        throw std::runtime_error("Cannot open the tree dump " + path);
+    }
+    if (!file.read(reinterpret_cast<char*>(&dump_header), sizeof(dump_header)) ||
+        std::memcmp(dump_header.magic, kTreeDumpMagic, sizeof(kTreeDumpMagic)) != 0) {
+        throw std::runtime_error(path + " is not a tree dump");
+    }
+}
+
+bool TreeDumpReader::next_node(TreeDumpNode& node) {
+    if (nodes_read == dump_header.node_count ||
+        !file.read(reinterpret_cast<char*>(&node), sizeof(node))) {
+        return false;
+    }
+    nodes_read++;
+    return true;
+}
+
+bool TreeDumpReader::next_edge(TreeDumpEdge& edge) {
+    if (nodes_read != dump_header.node_count || edges_read == dump_header.edge_count ||
+        !file.read(reinterpret_cast<char*>(&edge), sizeof(edge))) {
+        return false;
+    }
+    edges_read++;
+    return true;
+}
+
+void print_tree_dump(const std::string& path, std::ostream& out, int top_n, int max_depth) {
+    TreeDumpReader reader(path);
+    const TreeDumpHeader& header = reader.header();
+
+    std::vector<TreeDumpNode> nodes;
+    std::vector<TreeDumpEdge> edges;
+    nodes.reserve(header.node_count);
+    edges.reserve(header.edge_count);
+    TreeDumpNode node;
+    while (reader.next_node(node)) {
+        nodes.push_back(node);
+    }
+    TreeDumpEdge edge;
+    while (reader.next_edge(edge)) {
+        edges.push_back(edge);
+    }
+    if (nodes.size() != header.node_count || edges.size() != header.edge_count) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    for (const TreeDumpNode& dumped : nodes) {
+        if (dumped.num_edges > 0 && static_cast<std::uint64_t>(dumped.first_edge) + dumped.num_edges > edges.size()) {
+            throw std::runtime_error(path + " has edges out of range");
+        }
+    }
+    if (header.root >= nodes.size()) {
+        throw std::runtime_error(path + " has no root");
+    }
+
+    const TreeDumpNode& root = nodes[header.root];
+    out << "Tree: " << nodes.size() << " nodes, " << edges.size() << " edges\n"
+        << "Root: " << static_cast<Cell_state>(root.player) << " to move | Visits: " << root.visit_count
+        << " | NN Value: " << std::fixed << std::setprecision(3) << root.value_from_nn << "\n";
+    print_children(nodes, edges, header.root, 1, top_n, max_depth, out);
+}
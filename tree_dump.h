@@ -0,0 +1,112 @@
+#ifndef TREE_DUMP_H
+#define TREE_DUMP_H
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+/**
+ * @brief Header of a search tree dump (see Mcts_agent::export_tree)
+ *
+ * A dump is the header followed by node_count TreeDumpNode records, then
+ * edge_count TreeDumpEdge records. Nodes and edges keep their arena indices:
+ * the edges of a node are edges [first_edge, first_edge + num_edges), and a
+ * node reached through several move orders appears once, as the child of
+ * every edge leading to it.
+ */
+struct TreeDumpHeader {
+    char magic[8];
+    std::uint32_t root;
+    std::uint32_t reserved;
+    std::uint64_t node_count;
+    std::uint64_t edge_count;
+};
+
+/**
+ * @brief One node of a dumped tree
+ */
+struct TreeDumpNode {
+    float value_from_nn;       // Network value for the player to move
+    std::int32_t visit_count;
+    std::uint32_t first_edge;
+    std::uint32_t num_edges;   // 0 for leaves
+    std::uint8_t player;       // Cell_state of the player to move
+    std::uint8_t proof;        // 0 unknown, 1 proven win, 2 proven loss for the player to move
+    std::uint8_t expanded;
+    std::uint8_t reserved;
+};
+
+/**
+ * @brief One edge (move) of a dumped tree
+ */
+struct TreeDumpEdge {
+    std::uint16_t move_index;  // Index of the move in the flattened policy (Board::index_to_move)
+    std::uint16_t reserved;
+    float prior;
+    std::int32_t visit_count;
+    float value_sum;           // From the point of view of the player choosing the move
+    std::uint32_t child;       // Node reached by the move, 0xFFFFFFFF if never visited
+};
+
+static_assert(std::is_trivially_copyable_v<TreeDumpNode> && std::is_trivially_copyable_v<TreeDumpEdge>,
+              "tree dumps are written as raw bytes");
+
+constexpr char kTreeDumpMagic[8] = {'F', 'N', 'T', 'R', 'E', 'E', '0', '1'};
+
+/**
+ * @brief Streaming reader of a tree dump
+ *
+ * Reads the nodes, then the edges, one record at a time without loading the
+ * whole file.
+ */
+class TreeDumpReader {
+public:
+    /**
+     * @brief Opens a dump and reads its header
+     *
+     * @throws std::runtime_error if the file is missing or not a tree dump
+     */
+    explicit TreeDumpReader(const std::string& path);
+
+    const TreeDumpHeader& header() const { return dump_header; }
+
+    /**
+     * @brief Reads the next node
+     *
+     * @return false once all nodes have been read
+     */
+    bool next_node(TreeDumpNode& node);
+
+    /**
+     * @brief Reads the next edge; all nodes must have been read first
+     *
+     * @return false once all edges have been read
+     */
+    bool next_edge(TreeDumpEdge& edge);
+
+private:
+    std::ifstream file;
+    TreeDumpHeader dump_header;
+    std::uint64_t nodes_read;
+    std::uint64_t edges_read;
+};
+
+/**
+ * @brief Prints the most visited lines of a dumped tree
+ *
+ * Lists the top_n most visited moves of the root with their visits, prior,
+ * mean value and network value, then recursively the top_n moves under each
+ * of them, down to max_depth moves from the root.
+ *
+ * @param path Dump to print
+ * @param out Stream receiving the text
+ * @param top_n Moves printed per node
+ * @param max_depth Deepest level printed
+ *
+ * @throws std::runtime_error if the dump cannot be read
+ */
+void print_tree_dump(const std::string& path, std::ostream& out, int top_n = 5, int max_depth = 3);
+
+#endif // TREE_DUMP_H
@@ -0,0 +1,27 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "tree_dump.h"
+
+/**
+ * @brief Prints the most visited lines of a tree dump written by Mcts_agent::export_tree.
+ *
+ * Usage: fanorona_tree <dump file> [top moves per node] [depth]
+ */
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <dump file> [top moves per node] [depth]\n";
+    return 1;
+  }
+  const int top_n = argc > 2 ? std::atoi(argv[2]) : 5;
+  const int max_depth = argc > 3 ? std::atoi(argv[3]) : 3;
+
+  try {
+    print_tree_dump(argv[1], std::cout, top_n, max_depth);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}